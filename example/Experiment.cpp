@@ -16,11 +16,23 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cmath>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 #include <chrono>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #if defined(ParallelizationProvider_IntelTBB)
 #include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 #elif defined(ParallelizationProvider_OpenMP)
 #include <omp.h>
 #endif
@@ -28,50 +40,66 @@
 #include "NormalCore.hpp"
 #include "RelationalCore.hpp"
 #include "FilteringCore.hpp"
+#include "FusedFilteringCore.hpp"
+#include "ShardedFilteringCore.hpp"
+#include "SweepFilteringCore.hpp"
+#include "DetectorPool.hpp"
+#include "Delta.hpp"
+#include "ReorderBuffer.hpp"
+#include "NodeKey.hpp"
+#include "MultiAspectCore.hpp"
+#include "TopK.hpp"
+#include "ScoreQuantile.hpp"
+#include "Ingestion.hpp"
+#include "CoreFactory.hpp"
+#include "AUROC.hpp"
+#include "EdgeFile.hpp"
+#include "CsvStream.hpp"
+#include "ScoreSink.hpp"
 
 using namespace std::chrono; // Only for time-related functions, otherwise the statements are too long
 
+// # seeds a sweep runner scores at once, each holds numConfig arrays of n scores
+// So about as many arrays are alive as threads, as with one FilteringCore per thread, instead of numConfig times more
+int NumTaskSweep(size_t numConfig) {
+	return std::max(1, static_cast<int>(std::thread::hardware_concurrency() / std::max<size_t>(numConfig, 1)));
+}
+
 void ThresholdVsAUC(int n, const char* pathGroundTruth, int numColumn, const std::vector<float>& thresholds, int numRepeat, const int* source, const int* destination, const int* timestamp) {
 	// If threshold is 0, then all edges will be rejected, and all edges will get 0 score.
 
 	const auto seed = new int[numRepeat];
 	const auto auc = new float[thresholds.size() * numRepeat];
 	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	const auto label = new float[n];
+	const auto fileLabel = fopen(pathGroundTruth, "r");
+	for (int i = 0; i < n; i++)
+		fscanf(fileLabel, "%f", &label[i]);
+	fclose(fileLabel);
 
+	// All thresholds of a seed share one pass, see SweepFilteringCore
+	// MIDAS::NormalCore and MIDAS::RelationalCore do not use thresholds
+
+	const int numTask = NumTaskSweep(thresholds.size());
 #ifdef ParallelizationProvider_IntelTBB
-	tbb::parallel_for<int>(0, thresholds.size(), [&](int i) {
-		tbb::parallel_for<int>(0, numRepeat, [&](int j) {
+	tbb::task_arena arena(numTask);
+	arena.execute([&] { tbb::parallel_for<int>(0, numRepeat, [&](int j) {
 #else // @formatter:off
-	#pragma omp parallel for
-	for (int i = 0; i < thresholds.size(); i++) {
-		for (int j = 0; j < numRepeat; j++) {
+	#pragma omp parallel for num_threads(numTask)
+	for (int j = 0; j < numRepeat; j++) {
 #endif // @formatter:on
-			srand(seed[j]);
-
-			char pathScore[260];
-			sprintf(pathScore, SOLUTION_DIR"temp/Score%d.txt", i * numRepeat + j);
-			const auto fileScore = fopen(pathScore, "w");
-			// MIDAS::NormalCore midas(2, numColumn); // These two cores do not use thresholds
-			// MIDAS::RelationalCore midas(2, numColumn);
-			MIDAS::FilteringCore midas(2, numColumn, thresholds[i]);
-			for (int k = 0; k < n; k++)
-				fprintf(fileScore, "%f\n", midas(source[k], destination[k], timestamp[k]));
-			fclose(fileScore);
-
-			char command[1024];
-			sprintf(command, "python %s %s %s %d", SOLUTION_DIR"util/EvaluateScore.py", pathGroundTruth, pathScore, i * numRepeat + j);
-			system(command);
-
-			char pathAUC[260];
-			sprintf(pathAUC, SOLUTION_DIR"temp/AUC%d.txt", i * numRepeat + j);
-			const auto fileAUC = fopen(pathAUC, "r");
-			fscanf(fileAUC, "%f", auc + i * numRepeat + j);
-			fclose(fileAUC);
+		const auto score = new float[thresholds.size() * n];
+		std::vector<float*> scoreOut(thresholds.size());
+		for (int i = 0; i < thresholds.size(); i++)
+			scoreOut[i] = score + size_t(i) * n;
+		MIDAS::SweepFilteringCore midas(MIDAS::Random(seed[j]), 2, numColumn, thresholds);
+		midas.ScoreBatch(source, destination, timestamp, scoreOut.data(), n);
+		for (int i = 0; i < thresholds.size(); i++)
+			auc[i * numRepeat + j] = AUROC(label, scoreOut[i], n);
+		delete[] score;
 #ifdef ParallelizationProvider_IntelTBB
-		});
-	});
+	}); });
 #else // @formatter:off
-		}
 	}
 #endif // @formatter:on
 	const auto fileResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
@@ -83,6 +111,7 @@ void ThresholdVsAUC(int n, const char* pathGroundTruth, int numColumn, const std
 
 	delete[] seed;
 	delete[] auc;
+	delete[] label;
 }
 
 void ThresholdVsTime(int n, int numColumn, const std::vector<float>& thresholds, int numRepeat, const int* source, const int* destination, const int* timestamp) {
@@ -91,10 +120,9 @@ void ThresholdVsTime(int n, int numColumn, const std::vector<float>& thresholds,
 	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
 	for (int i = 0; i < thresholds.size(); i++) {
 		for (int j = 0; j < numRepeat; j++) {
-			srand(seed[j]);
-			// MIDAS::NormalCore midas(2, numColumn); // These two cores do not use thresholds
-			// MIDAS::RelationalCore midas(2, numColumn);
-			MIDAS::FilteringCore midas(2, numColumn, thresholds[i]);
+			// MIDAS::NormalCore midas(MIDAS::Random(seed[j]), 2, numColumn); // These two cores do not use thresholds
+			// MIDAS::RelationalCore midas(MIDAS::Random(seed[j]), 2, numColumn);
+			MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), 2, numColumn, thresholds[i]);
 			const auto timeBegin = high_resolution_clock::now();
 			for (int k = 0; k < n; k++)
 				midas(source[k], destination[k], timestamp[k]);
@@ -119,14 +147,10 @@ void ReproduceROC(int n, const char* pathGroundTruth, int numColumn, float thres
 	// MIDAS::NormalCore midas(2, numColumn);
 	// MIDAS::RelationalCore midas(2, numColumn);
 	MIDAS::FilteringCore midas(2, numColumn, threshold);
-	for (int i = 0; i < n; i++)
-		score[i] = midas(source[i], destination[i], timestamp[i]);
+	midas.ScoreBatch(source, destination, timestamp, score, n);
 
-	const auto pathScore = SOLUTION_DIR"temp/Score.txt";
-	const auto fileScore = fopen(pathScore, "w");
-	for (int i = 0; i < n; i++)
-		fprintf(fileScore, "%f\n", score[i]);
-	fclose(fileScore);
+	const auto pathScore = SOLUTION_DIR"temp/Score.bin";
+	MIDAS::BinaryScoreSink(pathScore).Write(score, n);
 
 	printf("// Reproduction is done, python is generating the ROC curve\n");
 
@@ -143,10 +167,9 @@ void NumRecordVsTime(int numColumn, float threshold, const std::vector<int>& num
 	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
 	for (int i = 0; i < numsRecord.size(); i++) {
 		for (int j = 0; j < numRepeat; j++) {
-			srand(seed[j]);
-			// MIDAS::NormalCore midas(2, numColumn);
-			// MIDAS::RelationalCore midas(2, numColumn);
-			MIDAS::FilteringCore midas(2, numColumn, threshold);
+			// MIDAS::NormalCore midas(MIDAS::Random(seed[j]), 2, numColumn);
+			// MIDAS::RelationalCore midas(MIDAS::Random(seed[j]), 2, numColumn);
+			MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), 2, numColumn, threshold);
 			const auto timeBegin = std::chrono::high_resolution_clock::now();
 			for (int k = 0; k < numsRecord[i]; k++)
 				midas(source[k], destination[k], timestamp[k]);
@@ -170,10 +193,9 @@ void NumColumnVsTime(int n, const std::vector<int>& numsColumn, float threshold,
 	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
 	for (int i = 0; i < numsColumn.size(); i++) {
 		for (int j = 0; j < numRepeat; j++) {
-			srand(seed[j]);
-			// MIDAS::NormalCore midas(2, numsColumn[i]);
-			// MIDAS::RelationalCore midas(2, numsColumn[i]);
-			MIDAS::FilteringCore midas(2, numsColumn[i], threshold);
+			// MIDAS::NormalCore midas(MIDAS::Random(seed[j]), 2, numsColumn[i]);
+			// MIDAS::RelationalCore midas(MIDAS::Random(seed[j]), 2, numsColumn[i]);
+			MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), 2, numsColumn[i], threshold);
 			const auto timeBegin = high_resolution_clock::now();
 			for (int k = 0; k < n; k++)
 				midas(source[k], destination[k], timestamp[k]);
@@ -191,10 +213,851 @@ void NumColumnVsTime(int n, const std::vector<int>& numsColumn, float threshold,
 	delete[] seed;
 }
 
+void LayoutVsTime(int n, const std::vector<int>& numsColumn, float threshold, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// Separate CMSs (FilteringCore) vs cell-interleaved CMSs (FusedFilteringCore), same seed gives same scores, which is checked
+	// Both use ScoreBatch() and a compile-time numRow, so only the layout differs
+
+	const auto time = new long long[numsColumn.size() * numRepeat * 2];
+	const auto seed = new int[numRepeat];
+	const auto score = new float[n];
+	const auto scoreFused = new float[n];
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	for (int i = 0; i < numsColumn.size(); i++) {
+		for (int j = 0; j < numRepeat; j++) {
+			MIDAS::BasicFilteringCore<2> midas(MIDAS::Random(seed[j]), 2, numsColumn[i], threshold);
+			auto timeBegin = high_resolution_clock::now();
+			midas.ScoreBatch(source, destination, timestamp, score, n);
+			printf("Separate%03d = %lldus\n", j, time[(i * numRepeat + j) * 2] = duration_cast<microseconds>(high_resolution_clock::now() - timeBegin).count());
+
+			MIDAS::BasicFusedFilteringCore<2> midasFused(MIDAS::Random(seed[j]), 2, numsColumn[i], threshold);
+			timeBegin = high_resolution_clock::now();
+			midasFused.ScoreBatch(source, destination, timestamp, scoreFused, n);
+			printf("Fused%03d = %lldus, %s scores\n", j, time[(i * numRepeat + j) * 2 + 1] = duration_cast<microseconds>(high_resolution_clock::now() - timeBegin).count(), std::equal(score, score + n, scoreFused) ? "same" : "DIFFERENT");
+		}
+		printf("// Above results use numColumn = %d\n", numsColumn[i]);
+	}
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numColumn,threshold,layout,seed,time\n"); // Microsecond (us)
+	for (int i = 0; i < numsColumn.size(); i++)
+		for (int j = 0; j < numRepeat; j++) {
+			fprintf(fileExperimentResult, "%d,%g,separate,%d,%lld\n", numsColumn[i], threshold, seed[j], time[(i * numRepeat + j) * 2]);
+			fprintf(fileExperimentResult, "%d,%g,fused,%d,%lld\n", numsColumn[i], threshold, seed[j], time[(i * numRepeat + j) * 2 + 1]);
+		}
+	fclose(fileExperimentResult);
+	delete[] time;
+	delete[] seed;
+	delete[] score;
+	delete[] scoreFused;
+}
+
+void NumRowVsLatency(int n, int numColumn, float threshold, const std::vector<int>& numsRow, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// Runtime numRow (FilteringCore) vs compile-time numRow (MakeFilteringCore()), same seed gives same scores
+
+	const auto latency = new double[numsRow.size() * numRepeat * 2];
+	const auto seed = new int[numRepeat];
+	const auto score = new float[n];
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	for (int i = 0; i < numsRow.size(); i++) {
+		for (int j = 0; j < numRepeat; j++) {
+			MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), numsRow[i], numColumn, threshold);
+			auto timeBegin = high_resolution_clock::now();
+			midas.ScoreBatch(source, destination, timestamp, score, n);
+			printf("Runtime%03d = %.2fns\n", j, latency[(i * numRepeat + j) * 2] = 1. * duration_cast<nanoseconds>(high_resolution_clock::now() - timeBegin).count() / n);
+
+			const auto midasSpecialized = MIDAS::MakeFilteringCore(MIDAS::Random(seed[j]), numsRow[i], numColumn, threshold);
+			timeBegin = high_resolution_clock::now();
+			midasSpecialized->ScoreBatch(source, destination, timestamp, score, n);
+			printf("CompileTime%03d = %.2fns\n", j, latency[(i * numRepeat + j) * 2 + 1] = 1. * duration_cast<nanoseconds>(high_resolution_clock::now() - timeBegin).count() / n);
+		}
+		printf("// Above results use numRow = %d\n", numsRow[i]);
+	}
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numRow,numColumn,threshold,specialization,seed,latency\n"); // Nanosecond (ns) per record
+	for (int i = 0; i < numsRow.size(); i++)
+		for (int j = 0; j < numRepeat; j++) {
+			fprintf(fileExperimentResult, "%d,%d,%g,runtime,%d,%f\n", numsRow[i], numColumn, threshold, seed[j], latency[(i * numRepeat + j) * 2]);
+			fprintf(fileExperimentResult, "%d,%d,%g,compileTime,%d,%f\n", numsRow[i], numColumn, threshold, seed[j], latency[(i * numRepeat + j) * 2 + 1]);
+		}
+	fclose(fileExperimentResult);
+	delete[] latency;
+	delete[] seed;
+	delete[] score;
+}
+
+void KernelVsBandwidth(const std::vector<int>& numsColumn, int numRepeat) {
+	// Whole-CMS sweeps of every kernel level this CPU supports, in GB/s, the dataset is not used
+	// Bytes per cell: Fill writes 4, Scale reads and writes 4, ConditionalMerge reads 12 and writes 8
+
+	const int numLevel = MIDAS::Kernel::Detect() + 1;
+	const int numKernel = 3;
+	const char* const nameKernel[numKernel] = {"fill", "scale", "conditionalMerge"};
+	const int bytePerCell[numKernel] = {4, 8, 20};
+	const auto bandwidth = new double[numsColumn.size() * numLevel * numKernel * numRepeat];
+	for (int i = 0; i < numsColumn.size(); i++) {
+		const int lenData = 2 * numsColumn[i]; // As if numRow = 2
+		const auto current = MIDAS::Kernel::AlignedNew<float>(lenData);
+		const auto total = MIDAS::Kernel::AlignedNew<float>(lenData);
+		const auto score = MIDAS::Kernel::AlignedNew<float>(lenData);
+		for (int k = 0; k < lenData; k++) {
+			current[k] = rand() % 100;
+			total[k] = rand() % 100;
+			score[k] = rand() % 2000; // About half below the threshold
+		}
+		const int numSweep = std::max(1, (1 << 28) / lenData); // About 1G cells per measurement
+		for (int l = 0; l < numLevel; l++) {
+			const auto table = MIDAS::Kernel::TableOf(static_cast<MIDAS::Kernel::Level>(l));
+			for (int k = 0; k < numKernel; k++)
+				for (int j = 0; j < numRepeat; j++) {
+					const auto timeBegin = high_resolution_clock::now();
+					for (int s = 0; s < numSweep; s++)
+						switch (k) {
+							case 0:
+								table.Fill(current, lenData, 1);
+								break;
+							case 1:
+								table.Scale(current, lenData, 1); // 1 keeps values finite over many sweeps
+								break;
+							default:
+								table.ConditionalMerge(current, total, score, lenData, 1000, 1, 1);
+						}
+					const double second = duration<double>(high_resolution_clock::now() - timeBegin).count();
+					printf("%s%03d = %.2fGB/s\n", nameKernel[k], j, bandwidth[((i * numLevel + l) * numKernel + k) * numRepeat + j] = 1e-9 * bytePerCell[k] * lenData * numSweep / second);
+				}
+			printf("// Above results use %s\n", table.name);
+		}
+		printf("// Above results use numColumn = %d\n", numsColumn[i]);
+		MIDAS::Kernel::AlignedDelete(current);
+		MIDAS::Kernel::AlignedDelete(total);
+		MIDAS::Kernel::AlignedDelete(score);
+	}
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numColumn,level,kernel,repeat,bandwidth\n"); // Gigabyte per second (GB/s)
+	for (int i = 0; i < numsColumn.size(); i++)
+		for (int l = 0; l < numLevel; l++)
+			for (int k = 0; k < numKernel; k++)
+				for (int j = 0; j < numRepeat; j++)
+					fprintf(fileExperimentResult, "%d,%s,%s,%d,%f\n", numsColumn[i], MIDAS::Kernel::TableOf(static_cast<MIDAS::Kernel::Level>(l)).name, nameKernel[k], j, bandwidth[((i * numLevel + l) * numKernel + k) * numRepeat + j]);
+	fclose(fileExperimentResult);
+	delete[] bandwidth;
+}
+
+template<class Storage, class ScoreStorage>
+long long TimeStorage(MIDAS::Random random, int n, int numColumn, float threshold, bool incremental, const int* source, const int* destination, const int* timestamp, float* scoreOut) {
+	MIDAS::BasicFilteringCore<2, MIDAS::ModuloHash, Storage, ScoreStorage> midas(random, 2, numColumn, threshold, 0.5, incremental);
+	const auto timeBegin = high_resolution_clock::now();
+	midas.ScoreBatch(source, destination, timestamp, scoreOut, n);
+	return duration_cast<microseconds>(high_resolution_clock::now() - timeBegin).count();
+}
+
+void StorageVsAUC(int n, const char* pathGroundTruth, const std::vector<int>& numsColumn, float threshold, bool incremental, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// Cell types of count/score CMSs of MIDAS-F, footprint is the bytes of all 9 CMSs, AUROC is computed in-process
+	// Reduced storages pay off when the CMSs no longer fit in cache, the sweeps of the dense merge are scalar for them, so consider incremental = true
+
+	const int numStorage = 4;
+	const char* const nameStorage[numStorage] = {"float/float", "float/bfloat16", "fixed32/bfloat16", "fixed16/bfloat16"};
+	const int byteCount[numStorage] = {4, 4, 4, 2}; // Per cell of a count CMS
+	const int byteScore[numStorage] = {4, 2, 2, 2}; // Per cell of a score CMS
+	const auto time = new long long[numsColumn.size() * numStorage * numRepeat];
+	const auto auc = new double[numsColumn.size() * numStorage * numRepeat];
+	const auto seed = new int[numRepeat];
+	const auto score = new float[n];
+	const auto label = new float[n];
+	const auto fileLabel = fopen(pathGroundTruth, "r");
+	for (int i = 0; i < n; i++)
+		fscanf(fileLabel, "%f", &label[i]);
+	fclose(fileLabel);
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	for (int i = 0; i < numsColumn.size(); i++) {
+		for (int k = 0; k < numStorage; k++) {
+			for (int j = 0; j < numRepeat; j++) {
+				const int l = (i * numStorage + k) * numRepeat + j;
+				switch (k) {
+					case 0:
+						time[l] = TimeStorage<MIDAS::FloatStorage, MIDAS::FloatStorage>(MIDAS::Random(seed[j]), n, numsColumn[i], threshold, incremental, source, destination, timestamp, score);
+						break;
+					case 1:
+						time[l] = TimeStorage<MIDAS::FloatStorage, MIDAS::BFloat16Storage>(MIDAS::Random(seed[j]), n, numsColumn[i], threshold, incremental, source, destination, timestamp, score);
+						break;
+					case 2:
+						time[l] = TimeStorage<MIDAS::Fixed32Storage, MIDAS::BFloat16Storage>(MIDAS::Random(seed[j]), n, numsColumn[i], threshold, incremental, source, destination, timestamp, score);
+						break;
+					default:
+						time[l] = TimeStorage<MIDAS::Fixed16Storage, MIDAS::BFloat16Storage>(MIDAS::Random(seed[j]), n, numsColumn[i], threshold, incremental, source, destination, timestamp, score);
+				}
+				auc[l] = AUROC(label, score, n);
+				printf("%s%03d = %lldus, ROC-AUC = %.4f\n", nameStorage[k], j, time[l], auc[l]);
+			}
+		}
+		printf("// Above results use numColumn = %d\n", numsColumn[i]);
+	}
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numColumn,threshold,storage,footprint,seed,time,auc\n"); // Byte (B), microsecond (us)
+	for (int i = 0; i < numsColumn.size(); i++)
+		for (int k = 0; k < numStorage; k++)
+			for (int j = 0; j < numRepeat; j++)
+				fprintf(fileExperimentResult, "%d,%g,%s,%lld,%d,%lld,%f\n", numsColumn[i], threshold, nameStorage[k], 2ll * numsColumn[i] * (6 * byteCount[k] + 3 * byteScore[k]), seed[j], time[(i * numStorage + k) * numRepeat + j], auc[(i * numStorage + k) * numRepeat + j]);
+	fclose(fileExperimentResult);
+	delete[] time;
+	delete[] auc;
+	delete[] seed;
+	delete[] score;
+	delete[] label;
+}
+
+void NumThreadVsTime(int n, int numColumn, float threshold, const std::vector<int>& numsThread, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// ShardedFilteringCore vs FilteringCore, same seed gives same scores, which is checked
+	// DARPA has ~100 edges per tick, so the barriers of each tick dominate, denser streams scale better
+
+	const auto time = new long long[numsThread.size() * numRepeat];
+	const auto seed = new int[numRepeat];
+	const auto score = new float[n];
+	const auto scoreSharded = new float[n];
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	for (int j = 0; j < numRepeat; j++) {
+		MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+		const auto timeBegin = high_resolution_clock::now();
+		midas.ScoreBatch(source, destination, timestamp, score, n);
+		printf("Serial%03d = %lldms\n", j, duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count());
+		for (int i = 0; i < numsThread.size(); i++) {
+			MIDAS::ShardedFilteringCore midasSharded(MIDAS::Random(seed[j]), numsThread[i], 2, numColumn, threshold);
+			const auto timeBegin = high_resolution_clock::now();
+			midasSharded.ScoreBatch(source, destination, timestamp, scoreSharded, n);
+			time[i * numRepeat + j] = duration_cast<microseconds>(high_resolution_clock::now() - timeBegin).count();
+			printf("Sharded%03d = %lldus with %d threads, %s scores\n", j, time[i * numRepeat + j], numsThread[i], std::equal(score, score + n, scoreSharded) ? "same" : "DIFFERENT");
+		}
+	}
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numThread,numColumn,threshold,seed,time\n"); // Microsecond (us)
+	for (int i = 0; i < numsThread.size(); i++)
+		for (int j = 0; j < numRepeat; j++)
+			fprintf(fileExperimentResult, "%d,%d,%g,%d,%lld\n", numsThread[i], numColumn, threshold, seed[j], time[i * numRepeat + j]);
+	fclose(fileExperimentResult);
+	delete[] time;
+	delete[] seed;
+	delete[] score;
+	delete[] scoreSharded;
+}
+
+void SweepVsTime(int n, int numColumn, const std::vector<float>& thresholds, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// One FilteringCore per threshold vs one SweepFilteringCore of all thresholds, same seed gives same scores, which is checked
+
+	const auto seed = new int[numRepeat];
+	const auto score = new float[n];
+	const auto scoreSweep = new float[thresholds.size() * n];
+	std::vector<float*> scoreOut(thresholds.size());
+	for (int i = 0; i < thresholds.size(); i++)
+		scoreOut[i] = scoreSweep + size_t(i) * n;
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numConfig,numColumn,seed,timeSeparate,timeSweep\n"); // Millisecond (ms)
+	for (int j = 0; j < numRepeat; j++) {
+		MIDAS::SweepFilteringCore midasSweep(MIDAS::Random(seed[j]), 2, numColumn, thresholds);
+		auto timeBegin = high_resolution_clock::now();
+		midasSweep.ScoreBatch(source, destination, timestamp, scoreOut.data(), n);
+		const long long timeSweep = duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+		long long timeSeparate = 0;
+		bool same = true;
+		for (int i = 0; i < thresholds.size(); i++) {
+			MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), 2, numColumn, thresholds[i]);
+			timeBegin = high_resolution_clock::now();
+			midas.ScoreBatch(source, destination, timestamp, score, n);
+			timeSeparate += duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+			same &= std::equal(score, score + n, scoreOut[i]);
+		}
+		printf("Time%03d = %lldms separately, %lldms in one sweep, %s scores\n", j, timeSeparate, timeSweep, same ? "same" : "DIFFERENT");
+		fprintf(fileExperimentResult, "%d,%d,%d,%lld,%lld\n", int(thresholds.size()), numColumn, seed[j], timeSeparate, timeSweep);
+	}
+	fclose(fileExperimentResult);
+	delete[] seed;
+	delete[] score;
+	delete[] scoreSweep;
+}
+
+void NumTenantVsTime(int n, int numColumn, float threshold, const std::vector<int>& numsTenant, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// One FilteringCore per tenant vs one DetectorPool of all tenants, the tenant of an edge is its source modulo numTenant
+	// Time includes constructing and destroying detectors, same seed gives same scores, which is checked
+
+	const auto seed = new int[numRepeat];
+	const auto tenant = new int[n];
+	const auto score = new float[n];
+	const auto scorePool = new float[n];
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numTenant,numColumn,threshold,seed,timeSeparate,timePool\n"); // Millisecond (ms)
+	for (int i = 0; i < numsTenant.size(); i++) {
+		for (int k = 0; k < n; k++)
+			tenant[k] = source[k] % numsTenant[i];
+		for (int j = 0; j < numRepeat; j++) {
+			auto timeBegin = high_resolution_clock::now();
+			std::vector<std::unique_ptr<MIDAS::FilteringCore>> midas(numsTenant[i]);
+			for (int l = 0; l < numsTenant[i]; l++)
+				midas[l].reset(new MIDAS::FilteringCore(MIDAS::Random(seed[j]), 2, numColumn, threshold));
+			for (int k = 0; k < n; k++)
+				score[k] = (*midas[tenant[k]])(source[k], destination[k], timestamp[k]);
+			midas.clear();
+			const long long timeSeparate = duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+			timeBegin = high_resolution_clock::now();
+			MIDAS::DetectorPool pool(MIDAS::Random(seed[j]), numsTenant[i], 2, numColumn);
+			for (int l = 0; l < numsTenant[i]; l++)
+				pool.Create(threshold); // Ids are handed out from 0
+			pool.ScoreBatch(tenant, source, destination, timestamp, scorePool, n);
+			const long long timePool = duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+			printf("Time%03d = %lldms separately, %lldms in a pool, %s scores\n", j, timeSeparate, timePool, std::equal(score, score + n, scorePool) ? "same" : "DIFFERENT");
+			fprintf(fileExperimentResult, "%d,%d,%g,%d,%lld,%lld\n", numsTenant[i], numColumn, threshold, seed[j], timeSeparate, timePool);
+		}
+		printf("// Above results use numTenant = %d\n", numsTenant[i]);
+	}
+	fclose(fileExperimentResult);
+	delete[] seed;
+	delete[] tenant;
+	delete[] score;
+	delete[] scorePool;
+}
+
+void SnapshotVsTime(int n, int numColumn, float threshold, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// Score the first half, snapshot in the background while scoring the second half, then restore and score the second half again
+	// Stall is the time SaveInBackground() takes on the scoring thread, restore is the time to map the snapshot and build a core on it
+
+	const auto seed = new int[numRepeat];
+	const auto score = new float[n];
+	const auto scoreRestored = new float[n];
+	const int h = n / 2;
+	const auto pathSnapshot = SOLUTION_DIR"temp/Snapshot.bin";
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numColumn,threshold,seed,stall,save,restore\n"); // Microsecond (us)
+	for (int j = 0; j < numRepeat; j++) {
+		MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+		midas.ScoreBatch(source, destination, timestamp, score, h);
+		auto timeBegin = high_resolution_clock::now();
+		auto job = MIDAS::SaveInBackground(midas, pathSnapshot);
+		const long long timeStall = duration_cast<microseconds>(high_resolution_clock::now() - timeBegin).count();
+		midas.ScoreBatch(source + h, destination + h, timestamp + h, score + h, n - h);
+		const bool ok = job.Wait();
+		const long long timeSave = duration_cast<microseconds>(high_resolution_clock::now() - timeBegin).count();
+		timeBegin = high_resolution_clock::now();
+		const MIDAS::Snapshot snapshot(pathSnapshot);
+		if (!ok || !MIDAS::FilteringCore::Fits(snapshot) || MIDAS::BasicFilteringCore<0, MIDAS::ModuloHash, MIDAS::Fixed32Storage>::Fits(snapshot) || MIDAS::BasicFilteringCore<0, MIDAS::FastRangeHash>::Fits(snapshot)) { // Nor with other policies of the same sizes
+			printf("Snapshot%03d failed\n", j);
+			continue;
+		}
+		MIDAS::FilteringCore midasRestored(snapshot);
+		const long long timeRestore = duration_cast<microseconds>(high_resolution_clock::now() - timeBegin).count();
+		midasRestored.ScoreBatch(source + h, destination + h, timestamp + h, scoreRestored + h, n - h);
+		printf("Snapshot%03d: stall = %lldus, save = %lldus, restore = %lldus, %s scores\n", j, timeStall, timeSave, timeRestore, std::equal(score + h, score + n, scoreRestored + h) ? "same" : "DIFFERENT");
+		fprintf(fileExperimentResult, "%d,%g,%d,%lld,%lld,%lld\n", numColumn, threshold, seed[j], timeStall, timeSave, timeRestore);
+	}
+	fclose(fileExperimentResult);
+	remove(pathSnapshot);
+	delete[] seed;
+	delete[] score;
+	delete[] scoreRestored;
+}
+
+void NumNodeVsState(int n, int numColumn, const std::vector<int>& numsNode, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// Each node is a process with a NormalCore of the edges whose source modulo numNode is its id, it writes a delta file per tick
+	// The aggregator adds up the deltas of all nodes tick by tick, its cells and global scores are checked against one NormalCore of all edges
+	// Global scores are Query() at the end of each tick, produce is the time until all nodes exit, aggregate is the time of the aggregator
+
+	const auto seed = new int[numRepeat];
+	const auto score = new float[n];
+	const auto scoreAggregated = new float[n];
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numNode,numColumn,seed,timeProduce,timeAggregate,numByte\n"); // Millisecond (ms)
+	for (int i = 0; i < numsNode.size(); i++) {
+		const int numNode = numsNode[i];
+		std::vector<std::string> pathDelta(numNode);
+		for (int l = 0; l < numNode; l++)
+			pathDelta[l] = SOLUTION_DIR"temp/Delta" + std::to_string(l) + ".bin";
+		for (int j = 0; j < numRepeat; j++) {
+			const int seedNode = seed[j];
+			const auto Produce = [&](int node) {
+				MIDAS::NormalCore midas(MIDAS::Random(seedNode), 2, numColumn);
+				MIDAS::DeltaWriter<MIDAS::NormalCore> writer(midas, node);
+				const auto file = fopen(pathDelta[node].c_str(), "wb");
+				if (!file) return false;
+				bool ok = true;
+				for (int k = 0; k < n; k++) {
+					if (k && timestamp[k] != timestamp[k - 1]) {
+						midas.Advance(timestamp[k - 1]); // Every node ships every tick, even without edges of its own
+						ok = ok && writer.Write(file);
+					}
+					if (source[k] % numNode == node)
+						midas(source[k], destination[k], timestamp[k]);
+				}
+				midas.Advance(timestamp[n - 1]);
+				ok = ok && writer.Write(file);
+				return fclose(file) == 0 && ok;
+			};
+			auto timeBegin = high_resolution_clock::now();
+			bool ok = true;
+#ifdef _WIN32
+			for (int l = 0; l < numNode; l++)
+				ok = Produce(l) && ok;
+#else
+			std::vector<pid_t> pid(numNode);
+			for (int l = 0; l < numNode; l++)
+				if ((pid[l] = fork()) == 0)
+					_exit(Produce(l) ? 0 : 1);
+			for (int l = 0; l < numNode; l++) {
+				int status = 0;
+				ok = pid[l] > 0 && waitpid(pid[l], &status, 0) == pid[l] && WIFEXITED(status) && WEXITSTATUS(status) == 0 && ok;
+			}
+#endif
+			const long long timeProduce = duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+			timeBegin = high_resolution_clock::now();
+			MIDAS::NormalCore aggregator(MIDAS::Random(seed[j]), 2, numColumn);
+			std::vector<FILE*> file(numNode);
+			for (int l = 0; l < numNode; l++)
+				ok = (file[l] = fopen(pathDelta[l].c_str(), "rb")) && ok;
+			for (int k = 0, kTick = 0; ok && k < n; k++)
+				if (k + 1 == n || timestamp[k + 1] != timestamp[k]) { // Edges of this tick are [kTick, k]
+					for (int l = 0; l < numNode; l++)
+						ok = MIDAS::ApplyDelta(aggregator, file[l]) && ok;
+					for (; kTick <= k; kTick++)
+						scoreAggregated[kTick] = aggregator.Query(source[kTick], destination[kTick]);
+				}
+			long long numByte = 0;
+			for (int l = 0; l < numNode; l++)
+				if (file[l]) {
+					fseek(file[l], 0, SEEK_END);
+					numByte += ftell(file[l]);
+					fclose(file[l]);
+				}
+			const long long timeAggregate = duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+			MIDAS::NormalCore midas(MIDAS::Random(seed[j]), 2, numColumn);
+			for (int k = 0, kTick = 0; k < n; k++) {
+				midas(source[k], destination[k], timestamp[k]);
+				if (k + 1 == n || timestamp[k + 1] != timestamp[k])
+					for (; kTick <= k; kTick++)
+						score[kTick] = midas.Query(source[kTick], destination[kTick]);
+			}
+			const bool same = ok && std::equal(score, score + n, scoreAggregated) && std::equal(midas.numCurrent.data, midas.numCurrent.data + midas.numCurrent.lenData, aggregator.numCurrent.data) && std::equal(midas.numTotal.data, midas.numTotal.data + midas.numTotal.lenData, aggregator.numTotal.data);
+			printf("Node%03d: produce = %lldms, aggregate = %lldms, %.1fMiB of deltas, %s scores\n", j, timeProduce, timeAggregate, numByte / 1048576.0, same ? "same" : "DIFFERENT");
+			fprintf(fileExperimentResult, "%d,%d,%d,%lld,%lld,%lld\n", numNode, numColumn, seed[j], timeProduce, timeAggregate, numByte);
+		}
+		for (int l = 0; l < numNode; l++)
+			remove(pathDelta[l].c_str());
+		printf("// Above results use numNode = %d\n", numNode);
+	}
+	fclose(fileExperimentResult);
+	delete[] seed;
+	delete[] score;
+	delete[] scoreAggregated;
+}
+
+void NumAttributeVsTime(int n, int numColumn, float threshold, const std::vector<int>& numsAttribute, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// Records of source, destination and numAttribute - 2 synthetic attributes derived from both, aspects are every attribute and (source, destination)
+	// With 2 attributes, scores should be the same as FilteringCore, which is checked
+
+	const auto seed = new int[numRepeat];
+	const auto score = new float[n];
+	const auto scoreAspect = new float[n];
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numAttribute,numAspect,numColumn,threshold,seed,time\n"); // Millisecond (ms)
+	for (int i = 0; i < numsAttribute.size(); i++) {
+		const int numAttribute = numsAttribute[i];
+		std::vector<int> attribute(size_t(n) * numAttribute);
+		for (int k = 0; k < n; k++)
+			for (int l = 0; l < numAttribute; l++)
+				attribute[size_t(k) * numAttribute + l] = l == 0 ? source[k] : l == 1 ? destination[k] : (source[k] * 31 + destination[k] * l) % 1000;
+		std::vector<MIDAS::MultiAspectCore::Aspect> aspect = {{{0, 1}}}; // FilteringCore's order, edge, source, destination
+		for (const auto& a: MIDAS::MultiAspectCore::Singles(numAttribute))
+			aspect.push_back(a);
+		for (int j = 0; j < numRepeat; j++) {
+			const auto timeBegin = high_resolution_clock::now();
+			MIDAS::MultiAspectCore midas(MIDAS::Random(seed[j]), 2, numColumn, numAttribute, aspect, threshold);
+			midas.ScoreBatch(attribute.data(), timestamp, scoreAspect, n);
+			const long long time = duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+			if (numAttribute == 2) {
+				MIDAS::FilteringCore midasEdge(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+				midasEdge.ScoreBatch(source, destination, timestamp, score, n);
+				printf("Time%03d = %lldms, %s scores as FilteringCore\n", j, time, std::equal(score, score + n, scoreAspect) ? "same" : "DIFFERENT");
+			} else {
+				printf("Time%03d = %lldms\n", j, time);
+			}
+			fprintf(fileExperimentResult, "%d,%d,%d,%g,%d,%lld\n", numAttribute, midas.numAspect, numColumn, threshold, seed[j], time);
+		}
+		printf("// Above results use numAttribute = %d\n", numAttribute);
+	}
+	fclose(fileExperimentResult);
+	delete[] seed;
+	delete[] score;
+	delete[] scoreAspect;
+}
+
+void TopKVsTime(int n, int numColumn, float threshold, const std::vector<int>& numsTop, float factor, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// FilteringCore alone vs FilteringCore + AnomalyReport of numTop edges, sources and destinations, fed per batch of records
+	// Another thread queries the report as fast as it can meanwhile, the top sources of the last tick are printed
+
+	const auto seed = new int[numRepeat];
+	const auto score = new float[n];
+	const int lenBatch = 1 << 12;
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numTop,factor,numColumn,threshold,seed,timeCore,timeReport,numQuery\n"); // Millisecond (ms)
+	for (int i = 0; i < numsTop.size(); i++) {
+		for (int j = 0; j < numRepeat; j++) {
+			auto timeBegin = high_resolution_clock::now();
+			MIDAS::FilteringCore midasAlone(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+			midasAlone.ScoreBatch(source, destination, timestamp, score, n);
+			const long long timeCore = duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+			MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+			MIDAS::AnomalyReport report(numsTop[i], factor);
+			std::atomic<bool> done(false);
+			long long numQuery = 0;
+			std::thread reader([&]() {
+				std::vector<MIDAS::TopKEntry> top;
+				while (!done.load(std::memory_order_relaxed)) {
+					report.source.Query(top);
+					numQuery++;
+				}
+			});
+			timeBegin = high_resolution_clock::now();
+			for (int k = 0; k < n; k += lenBatch) {
+				const int m = std::min(lenBatch, n - k);
+				midas.ScoreBatch(source + k, destination + k, timestamp + k, score + k, m);
+				report.Batch(source + k, destination + k, timestamp + k, score + k, m);
+			}
+			report.Publish();
+			const long long timeReport = duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+			done = true;
+			reader.join();
+			std::vector<MIDAS::TopKEntry> top;
+			report.source.Query(top);
+			printf("Time%03d = %lldms alone, %lldms with a report, %lld queries, top source %d (%.1f)\n", j, timeCore, timeReport, numQuery, top.empty() ? -1 : int(top[0].key), top.empty() ? 0.f : top[0].score);
+			fprintf(fileExperimentResult, "%d,%g,%d,%g,%d,%lld,%lld,%lld\n", numsTop[i], factor, numColumn, threshold, seed[j], timeCore, timeReport, numQuery);
+		}
+		printf("// Above results use numTop = %d\n", numsTop[i]);
+	}
+	fclose(fileExperimentResult);
+	delete[] seed;
+	delete[] score;
+}
+
+void TopKVsBruteForce(const std::vector<int>& numsTop, float factor, float scoreBase, int numTick, int numRepeat) {
+	// TopK vs the decayed max score of every key, on synthetic records of scores about scoreBase over numTick ticks, the dataset is not used
+	// Scores far above 1e8 with factor < 1 push the implicit scale to its bound, so this checks the rescaling, same top scores up to rounding
+
+	const int numKey = 1 << 12;
+	const int numPerTick = 64;
+	const auto value = new double[numKey];
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numTop,factor,scoreBase,numTick,repeat,same\n");
+	for (int i = 0; i < numsTop.size(); i++) {
+		for (int j = 0; j < numRepeat; j++) {
+			MIDAS::TopK top(numsTop[i], factor);
+			std::fill(value, value + numKey, 0.);
+			for (int t = 1; t <= numTick; t++) {
+				if (t > 1)
+					std::for_each(value, value + numKey, [factor](double& a) { a *= factor; });
+				for (int k = 0; k < numPerTick; k++) {
+					const int key = rand() % numKey;
+					const float score = scoreBase * (1 + rand() % 1000 / 100.f);
+					value[key] = std::max(value[key], double(score));
+					top.Update(key, score, t);
+				}
+			}
+			top.Publish();
+			std::vector<MIDAS::TopKEntry> entry;
+			top.Query(entry);
+			std::vector<double> truth(value, value + numKey);
+			std::sort(truth.begin(), truth.end(), std::greater<double>());
+			bool same = entry.size() == std::min<size_t>(numsTop[i], std::count_if(value, value + numKey, [](double a) { return a > 0; }));
+			for (size_t k = 0; same && k < entry.size(); k++)
+				same = std::isfinite(entry[k].score) && std::abs(entry[k].score - truth[k]) <= 1e-4 * truth[k] && std::abs(value[entry[k].key] - truth[k]) <= 1e-4 * truth[k];
+			printf("TopK%03d: numTop = %d, top score %g vs %g, %s\n", j, numsTop[i], entry.empty() ? 0.f : entry[0].score, truth[0], same ? "same" : "DIFFERENT");
+			fprintf(fileExperimentResult, "%d,%g,%g,%d,%d,%d\n", numsTop[i], factor, scoreBase, numTick, j, same);
+		}
+	}
+	fclose(fileExperimentResult);
+	delete[] value;
+}
+
+void NumProducerVsThroughput(int n, int numColumn, float threshold, const std::vector<int>& numsProducer, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// Producer threads push edges round-robin into an Ingestion, which feeds a FilteringCore on its scorer thread
+	// Latency is from Push() to the callback, so it includes the wait for a full batch and for the slowest producer
+
+	const int numStatistic = 4; // Throughput (edge/s), median latency (us), 99th percentile latency (us), # full rings
+	const auto statistic = new double[numsProducer.size() * numRepeat * numStatistic];
+	const auto timePush = new long long[n];
+	const auto latency = new long long[n];
+	const auto seed = new int[numRepeat];
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	for (int i = 0; i < numsProducer.size(); i++) {
+		const int numProducer = numsProducer[i];
+		for (int j = 0; j < numRepeat; j++) {
+			MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+			std::vector<int> numOut(numProducer, 0); // # edges of each producer through the callback
+			const auto timeBegin = high_resolution_clock::now();
+			uint64_t numFull = 0;
+			{
+				MIDAS::Ingestion<MIDAS::FilteringCore> ingestion(midas, numProducer, 1 << 12, [&](const MIDAS::Ingestion<MIDAS::FilteringCore>::Edge* edge, const float*, size_t m) {
+					const long long now = duration_cast<nanoseconds>(high_resolution_clock::now().time_since_epoch()).count();
+					for (size_t k = 0; k < m; k++) {
+						const int l = numOut[edge[k].producer]++ * numProducer + edge[k].producer;
+						latency[l] = now - timePush[l];
+					}
+				});
+				std::vector<std::thread> producer;
+				for (int p = 0; p < numProducer; p++)
+					producer.emplace_back([&, p] {
+						for (int k = p; k < n; k += numProducer) {
+							timePush[k] = duration_cast<nanoseconds>(high_resolution_clock::now().time_since_epoch()).count();
+							ingestion.Push(p, source[k], destination[k], timestamp[k]);
+						}
+						ingestion.Close(p);
+					});
+				for (auto& p: producer)
+					p.join();
+				for (const auto& p: ingestion.producer)
+					numFull += p->numFull;
+			} // Destructor waits for the scorer
+			const auto s = statistic + (i * numRepeat + j) * numStatistic;
+			s[0] = n / duration<double>(high_resolution_clock::now() - timeBegin).count();
+			std::nth_element(latency, latency + n / 2, latency + n);
+			s[1] = latency[n / 2] / 1e3;
+			std::nth_element(latency, latency + n / 100 * 99, latency + n);
+			s[2] = latency[n / 100 * 99] / 1e3;
+			s[3] = numFull;
+			printf("Repeat%03d = %.2fM edge/s, latency p50 = %.1fus, p99 = %.1fus, # full = %.0f\n", j, s[0] / 1e6, s[1], s[2], s[3]);
+		}
+		printf("// Above results use numProducer = %d\n", numProducer);
+	}
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numProducer,numColumn,threshold,seed,throughput,latencyMedian,latencyP99,numFull\n"); // Edge per second, microsecond (us)
+	for (int i = 0; i < numsProducer.size(); i++)
+		for (int j = 0; j < numRepeat; j++) {
+			const auto s = statistic + (i * numRepeat + j) * numStatistic;
+			fprintf(fileExperimentResult, "%d,%d,%g,%d,%f,%f,%f,%.0f\n", numsProducer[i], numColumn, threshold, seed[j], s[0], s[1], s[2], s[3]);
+		}
+	fclose(fileExperimentResult);
+	delete[] statistic;
+	delete[] timePush;
+	delete[] latency;
+	delete[] seed;
+}
+
+void StreamVsTime(const char* pathData, int numColumn, float threshold, int numRepeat) {
+	// Whole file parsed and then scored, vs. CsvStream, which parses the next chunk on its own thread while this one is scored
+	// Streaming keeps two chunks in memory, so it also works for inputs larger than memory, e.g., stdin with path "-"
+
+	const int numMode = 2; // Parse then score, stream
+	const auto time = new double[numMode * numRepeat];
+	const auto scoreChunk = new float[1 << 16]; // Same as the default chunk length
+	for (int j = 0; j < numRepeat; j++) {
+		{
+			const auto timeBegin = high_resolution_clock::now();
+			std::vector<int> source, destination, timestamp;
+			MIDAS::CsvStream csv(pathData);
+			const int* s, * d, * t;
+			for (size_t m; (m = csv.Next(s, d, t));) {
+				source.insert(source.end(), s, s + m);
+				destination.insert(destination.end(), d, d + m);
+				timestamp.insert(timestamp.end(), t, t + m);
+			}
+			const auto score = new float[source.size()];
+			MIDAS::FilteringCore midas(2, numColumn, threshold);
+			midas.ScoreBatch(source.data(), destination.data(), timestamp.data(), score, source.size());
+			time[j * numMode] = duration<double>(high_resolution_clock::now() - timeBegin).count();
+			delete[] score;
+		}
+		{
+			const auto timeBegin = high_resolution_clock::now();
+			MIDAS::CsvStream csv(pathData);
+			MIDAS::FilteringCore midas(2, numColumn, threshold);
+			const int* s, * d, * t;
+			for (size_t m; (m = csv.Next(s, d, t));)
+				midas.ScoreBatch(s, d, t, scoreChunk, m);
+			time[j * numMode + 1] = duration<double>(high_resolution_clock::now() - timeBegin).count();
+		}
+		printf("Repeat%03d = %.3fs (parse then score), %.3fs (stream)\n", j, time[j * numMode], time[j * numMode + 1]);
+	}
+	printf("// Above results use numColumn = %d, threshold = %g\n", numColumn, threshold);
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numColumn,threshold,repeat,timeParseThenScore,timeStream\n"); // Second (s)
+	for (int j = 0; j < numRepeat; j++)
+		fprintf(fileExperimentResult, "%d,%g,%d,%f,%f\n", numColumn, threshold, j, time[j * numMode], time[j * numMode + 1]);
+	fclose(fileExperimentResult);
+	delete[] time;
+	delete[] scoreChunk;
+}
+
+void LatenessVsAUC(int n, const char* pathGroundTruth, int numColumn, float threshold, int delay, const std::vector<int>& latenesses, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// Records arrive late by up to delay ticks, sorted by timestamp + a uniform delay, then go through a ReorderBuffer of each lateness
+	// Dropped records get score 0, the 1st line of each seed is the in-order stream for reference
+
+	const auto seed = new int[numRepeat];
+	const auto order = new int[n];
+	const auto arrival = new int[n];
+	const auto score = new float[n];
+	const auto label = new float[n];
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	const auto fileLabel = fopen(pathGroundTruth, "r");
+	for (int i = 0; i < n; i++)
+		fscanf(fileLabel, "%f", &label[i]);
+	fclose(fileLabel);
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "delay,lateness,numColumn,threshold,seed,numReordered,numLate,auc\n");
+	for (int j = 0; j < numRepeat; j++) {
+		for (int k = 0; k < n; k++) {
+			order[k] = k;
+			arrival[k] = timestamp[k] + rand() % (delay + 1);
+		}
+		std::stable_sort(order, order + n, [&](int a, int b) { return arrival[a] < arrival[b]; });
+		MIDAS::FilteringCore midasInOrder(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+		midasInOrder.ScoreBatch(source, destination, timestamp, score, n);
+		const double aucInOrder = AUROC(label, score, n);
+		printf("Reorder%03d: in order, ROC-AUC = %.4f\n", j, aucInOrder);
+		fprintf(fileExperimentResult, "%d,%d,%d,%g,%d,%d,%d,%f\n", delay, -1, numColumn, threshold, seed[j], 0, 0, aucInOrder);
+		for (int i = 0; i < latenesses.size(); i++) {
+			std::fill(score, score + n, 0);
+			MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+			MIDAS::ReorderBuffer<MIDAS::FilteringCore> reorder(midas, latenesses[i], [&](const int*, const int*, const int* tag, int, const float* scoreTick, size_t m) {
+				for (size_t k = 0; k < m; k++)
+					score[tag[k]] = scoreTick[k];
+			});
+			for (int k = 0; k < n; k++)
+				reorder.Push(source[order[k]], destination[order[k]], timestamp[order[k]], order[k]);
+			reorder.Flush();
+			const double auc = AUROC(label, score, n);
+			printf("Reorder%03d: lateness = %d, %llu reordered, %llu late, ROC-AUC = %.4f\n", j, latenesses[i], reorder.numReordered, reorder.numLate, auc);
+			fprintf(fileExperimentResult, "%d,%d,%d,%g,%d,%llu,%llu,%f\n", delay, latenesses[i], numColumn, threshold, seed[j], reorder.numReordered, reorder.numLate, auc);
+		}
+	}
+	fclose(fileExperimentResult);
+	delete[] seed;
+	delete[] order;
+	delete[] arrival;
+	delete[] score;
+	delete[] label;
+}
+
+void KeyVsAUC(int n, const char* pathGroundTruth, int numColumn, float threshold, int capacity, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// Ids of the dataset are spread over 64-bit keys, then scored through KeyHash and KeyDictionary instead of the preprocessed ids
+	// Time includes mapping keys to ids, the dictionary gives ids in order of appearance, so its scores differ from the preprocessed ones
+
+	const auto seed = new int[numRepeat];
+	const auto sourceKey = new uint64_t[n];
+	const auto destinationKey = new uint64_t[n];
+	const auto score = new float[n];
+	const auto label = new float[n];
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	for (int k = 0; k < n; k++) {
+		sourceKey[k] = uint64_t(source[k]) * 0x9E3779B97F4A7C15ull + 0xC0FFEE; // Distinct, far apart, not small
+		destinationKey[k] = uint64_t(destination[k]) * 0x9E3779B97F4A7C15ull + 0xC0FFEE;
+	}
+	const auto fileLabel = fopen(pathGroundTruth, "r");
+	for (int i = 0; i < n; i++)
+		fscanf(fileLabel, "%f", &label[i]);
+	fclose(fileLabel);
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numColumn,threshold,capacity,seed,timeId,timeHash,timeDictionary,aucId,aucHash,aucDictionary\n"); // Millisecond (ms)
+	for (int j = 0; j < numRepeat; j++) {
+		auto timeBegin = high_resolution_clock::now();
+		MIDAS::FilteringCore midasId(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+		midasId.ScoreBatch(source, destination, timestamp, score, n);
+		const long long timeId = duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+		const double aucId = AUROC(label, score, n);
+		timeBegin = high_resolution_clock::now();
+		MIDAS::FilteringCore midasHash(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+		MIDAS::KeyHash hash(seed[j]);
+		MIDAS::ScoreKeyBatch(midasHash, hash, sourceKey, destinationKey, timestamp, score, n);
+		const long long timeHash = duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+		const double aucHash = AUROC(label, score, n);
+		timeBegin = high_resolution_clock::now();
+		MIDAS::FilteringCore midasDictionary(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+		MIDAS::KeyDictionary dictionary(capacity, seed[j]);
+		MIDAS::ScoreKeyBatch(midasDictionary, dictionary, sourceKey, destinationKey, timestamp, score, n);
+		const long long timeDictionary = duration_cast<milliseconds>(high_resolution_clock::now() - timeBegin).count();
+		const double aucDictionary = AUROC(label, score, n);
+		printf("Key%03d: id = %lldms / %.4f, hash = %lldms / %.4f, dictionary = %lldms / %.4f (%d keys, %llu overflows)\n", j, timeId, aucId, timeHash, aucHash, timeDictionary, aucDictionary, dictionary.numKey, dictionary.numOverflow);
+		fprintf(fileExperimentResult, "%d,%g,%d,%d,%lld,%lld,%lld,%f,%f,%f\n", numColumn, threshold, capacity, seed[j], timeId, timeHash, timeDictionary, aucId, aucHash, aucDictionary);
+	}
+	fclose(fileExperimentResult);
+	delete[] seed;
+	delete[] sourceKey;
+	delete[] destinationKey;
+	delete[] score;
+	delete[] label;
+}
+
+void QuantileVsAlert(int n, const char* pathGroundTruth, int numColumn, float threshold, const std::vector<double>& quantiles, int numRepeat, const int* source, const int* destination, const int* timestamp) {
+	// Scores of FilteringCore go through an AdaptiveThreshold of each quantile, alerts are compared with the ground truth
+	// Time of the stage alone is measured on the stored scores, so it excludes the core
+
+	const auto seed = new int[numRepeat];
+	const auto score = new float[n];
+	const auto label = new float[n];
+	const auto alert = new size_t[n];
+	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	const auto fileLabel = fopen(pathGroundTruth, "r");
+	for (int i = 0; i < n; i++)
+		fscanf(fileLabel, "%f", &label[i]);
+	fclose(fileLabel);
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "quantile,numColumn,threshold,seed,timeAlert,numAlert,numTruePositive,numPositive,thresholdAlert\n"); // Nanosecond (ns) per record
+	for (int j = 0; j < numRepeat; j++) {
+		MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), 2, numColumn, threshold);
+		midas.ScoreBatch(source, destination, timestamp, score, n);
+		const long long numPositive = std::count(label, label + n, 1.f);
+		for (int i = 0; i < quantiles.size(); i++) {
+			MIDAS::AdaptiveThreshold stage(quantiles[i]);
+			const auto timeBegin = high_resolution_clock::now();
+			const size_t numAlert = stage.Batch(score, n, alert);
+			const double timeAlert = duration_cast<nanoseconds>(high_resolution_clock::now() - timeBegin).count() / double(n);
+			long long numTruePositive = 0;
+			for (size_t k = 0; k < numAlert; k++)
+				numTruePositive += label[alert[k]] == 1;
+			printf("Alert%03d: quantile = %g, %.2fns per record, %zu alerts, precision = %.4f, recall = %.4f, threshold = %g\n", j, quantiles[i], timeAlert, numAlert, numAlert ? double(numTruePositive) / numAlert : 0., double(numTruePositive) / numPositive, stage.threshold);
+			fprintf(fileExperimentResult, "%g,%d,%g,%d,%f,%zu,%lld,%lld,%g\n", quantiles[i], numColumn, threshold, seed[j], timeAlert, numAlert, numTruePositive, numPositive, stage.threshold);
+		}
+	}
+	fclose(fileExperimentResult);
+	delete[] seed;
+	delete[] score;
+	delete[] label;
+	delete[] alert;
+}
+
+void WindowVsAUC(int n, const char* pathGroundTruth, int numColumn, float threshold, int lenWindow, int lenStep, const int* source, const int* destination, const int* timestamp) {
+	// ROC-AUC of the last lenWindow records, sampled every lenStep records, updated per record by SlidingAUROC instead of sorting each window
+	// Windows with only one class have NaN
+
+	const auto score = new float[n];
+	const auto label = new float[n];
+	const auto fileLabel = fopen(pathGroundTruth, "r");
+	for (int i = 0; i < n; i++)
+		fscanf(fileLabel, "%f", &label[i]);
+	fclose(fileLabel);
+	MIDAS::FilteringCore midas(2, numColumn, threshold);
+	midas.ScoreBatch(source, destination, timestamp, score, n);
+
+	SlidingAUROC<float> window(lenWindow);
+	const auto fileExperimentResult = fopen(SOLUTION_DIR"temp/Experiment.csv", "w");
+	fprintf(fileExperimentResult, "numColumn,threshold,lenWindow,index,auc\n");
+	for (int i = 0; i < n; i++) {
+		window.Push(label[i], score[i]);
+		if ((i + 1) % lenStep == 0)
+			fprintf(fileExperimentResult, "%d,%g,%d,%d,%f\n", numColumn, threshold, lenWindow, i, window());
+	}
+	fclose(fileExperimentResult);
+	printf("ROC-AUC = %.4f (last window), %.4f (all)\n", window(), AUROC(label, score, n));
+	delete[] score;
+	delete[] label;
+}
+
 void NumColumnVsAUC(int n, const char* pathGroundTruth, const std::vector<int>& numsColumn, float threshold, int numRepeat, const int* source, const int* destination, const int* timestamp) {
 	const auto seed = new int[numRepeat];
 	const auto auc = new float[numsColumn.size() * numRepeat];
 	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	const auto label = new float[n];
+	const auto fileLabel = fopen(pathGroundTruth, "r");
+	for (int i = 0; i < n; i++)
+		fscanf(fileLabel, "%f", &label[i]);
+	fclose(fileLabel);
 
 #ifdef ParallelizationProvider_IntelTBB
 	tbb::parallel_for<int>(0, numsColumn.size(), [&](int i) {
@@ -204,27 +1067,14 @@ void NumColumnVsAUC(int n, const char* pathGroundTruth, const std::vector<int>&
 	for (int i = 0; i < numsColumn.size(); i++) {
 		for (int j = 0; j < numRepeat; j++) {
 #endif // @formatter:on
-			srand(seed[j]);
-
-			char pathScore[260];
-			sprintf(pathScore, SOLUTION_DIR"temp/Score%d.txt", i * numRepeat + j);
-			const auto fileScore = fopen(pathScore, "w");
-			// MIDAS::NormalCore midas(2, numsColumn[i]);
-			// MIDAS::RelationalCore midas(2, numsColumn[i]);
-			MIDAS::FilteringCore midas(2, numsColumn[i], threshold);
+			const auto score = new float[n];
+			// MIDAS::NormalCore midas(MIDAS::Random(seed[j]), 2, numsColumn[i]);
+			// MIDAS::RelationalCore midas(MIDAS::Random(seed[j]), 2, numsColumn[i]);
+			MIDAS::FilteringCore midas(MIDAS::Random(seed[j]), 2, numsColumn[i], threshold);
 			for (int k = 0; k < n; k++)
-				fprintf(fileScore, "%f\n", midas(source[k], destination[k], timestamp[k]));
-			fclose(fileScore);
-
-			char command[1024];
-			sprintf(command, "python %s %s %s %d", SOLUTION_DIR"util/EvaluateScore.py", pathGroundTruth, pathScore, i * numRepeat + j);
-			system(command);
-
-			char pathAUC[260];
-			sprintf(pathAUC, SOLUTION_DIR"temp/AUC%d.txt", i * numRepeat + j);
-			const auto fileAUC = fopen(pathAUC, "r");
-			fscanf(fileAUC, "%f", auc + i * numRepeat + j);
-			fclose(fileAUC);
+				score[k] = midas(source[k], destination[k], timestamp[k]);
+			auc[i * numRepeat + j] = AUROC(label, score, n);
+			delete[] score;
 #ifdef ParallelizationProvider_IntelTBB
 		});
 	});
@@ -242,47 +1092,42 @@ void NumColumnVsAUC(int n, const char* pathGroundTruth, const std::vector<int>&
 
 	delete[] seed;
 	delete[] auc;
+	delete[] label;
 }
 
 void FactorVsAUC(int n, const char* pathGroundTruth, int numColumn, float threshold, const std::vector<float>& factors, int numRepeat, const int* source, const int* destination, const int* timestamp) {
 	const auto seed = new int[numRepeat];
 	const auto auc = new float[factors.size() * numRepeat];
 	std::for_each(seed, seed + numRepeat, [](int& a) { a = rand(); });
+	const auto label = new float[n];
+	const auto fileLabel = fopen(pathGroundTruth, "r");
+	for (int i = 0; i < n; i++)
+		fscanf(fileLabel, "%f", &label[i]);
+	fclose(fileLabel);
+
+	// All factors of a seed share one pass, see SweepFilteringCore
+	// MIDAS::NormalCore does not use factors, MIDAS::RelationalCore takes one factor
 
+	const int numTask = NumTaskSweep(factors.size());
 #ifdef ParallelizationProvider_IntelTBB
-	tbb::parallel_for<int>(0, factors.size(), [&](int i) {
-		tbb::parallel_for<int>(0, numRepeat, [&](int j) {
+	tbb::task_arena arena(numTask);
+	arena.execute([&] { tbb::parallel_for<int>(0, numRepeat, [&](int j) {
 #else // @formatter:off
-	#pragma omp parallel for
-	for (int i = 0; i < factors.size(); i++) {
-		for (int j = 0; j < numRepeat; j++) {
+	#pragma omp parallel for num_threads(numTask)
+	for (int j = 0; j < numRepeat; j++) {
 #endif // @formatter:on
-			srand(seed[j]);
-
-			char pathScore[260];
-			sprintf(pathScore, SOLUTION_DIR"temp/Score%d.txt", i * numRepeat + j);
-			const auto fileScore = fopen(pathScore, "w");
-			// MIDAS::NormalCore midas(2, numColumn); // This core does not use factors
-			// MIDAS::RelationalCore midas(2, numColumn, factors[i]);
-			MIDAS::FilteringCore midas(2, numColumn, threshold, factors[i]);
-			for (int k = 0; k < n; k++)
-				fprintf(fileScore, "%f\n", midas(source[k], destination[k], timestamp[k]));
-			fclose(fileScore);
-
-			char command[1024];
-			sprintf(command, "python %s %s %s %d", SOLUTION_DIR"util/EvaluateScore.py", pathGroundTruth, pathScore, i * numRepeat + j);
-			system(command);
-
-			char pathAUC[260];
-			sprintf(pathAUC, SOLUTION_DIR"temp/AUC%d.txt", i * numRepeat + j);
-			const auto fileAUC = fopen(pathAUC, "r");
-			fscanf(fileAUC, "%f", auc + i * numRepeat + j);
-			fclose(fileAUC);
+		const auto score = new float[factors.size() * n];
+		std::vector<float*> scoreOut(factors.size());
+		for (int i = 0; i < factors.size(); i++)
+			scoreOut[i] = score + size_t(i) * n;
+		MIDAS::SweepFilteringCore midas(MIDAS::Random(seed[j]), 2, numColumn, std::vector<float>(factors.size(), threshold), factors);
+		midas.ScoreBatch(source, destination, timestamp, scoreOut.data(), n);
+		for (int i = 0; i < factors.size(); i++)
+			auc[i * numRepeat + j] = AUROC(label, scoreOut[i], n);
+		delete[] score;
 #ifdef ParallelizationProvider_IntelTBB
-		});
-	});
+	}); });
 #else // @formatter:off
-		}
 	}
 #endif // @formatter:on
 
@@ -295,14 +1140,15 @@ void FactorVsAUC(int n, const char* pathGroundTruth, int numColumn, float thresh
 
 	delete[] seed;
 	delete[] auc;
+	delete[] label;
 }
 
 int main(int argc, char* argv[]) {
 	// Parameter
 	// --------------------------------------------------------------------------------
 
-	const auto pathMeta = SOLUTION_DIR"data/DARPA/darpa_shape.txt";
 	const auto pathData = SOLUTION_DIR"data/DARPA/darpa_processed.csv";
+	const auto pathBinary = SOLUTION_DIR"data/DARPA/darpa_processed.bin";
 	const auto pathGroundTruth = SOLUTION_DIR"data/DARPA/darpa_ground_truth.csv";
 
 	// Read dataset
@@ -310,21 +1156,15 @@ int main(int argc, char* argv[]) {
 
 	srand(time(nullptr));
 
-	// Read meta (total number of records)
-	// PreprocessData.py will generate those meta files
-
-	const auto fileMeta = fopen(pathMeta, "r");
-	int n;
-	fscanf(fileMeta, "%d", &n);
-	fclose(fileMeta);
+	// The CSV from PreprocessData.py is converted to the binary format on the first run, later runs map the binary file directly
 
-	const auto fileData = fopen(pathData, "r");
-	const auto source = new int[n];
-	const auto destination = new int[n];
-	const auto timestamp = new int[n];
-	for (int i = 0; i < n; i++)
-		fscanf(fileData, "%d,%d,%d", &source[i], &destination[i], &timestamp[i]);
-	fclose(fileData);
+	if (!MIDAS::EdgeFile(pathBinary).header)
+		MIDAS::ConvertEdgeFile(pathData, pathBinary);
+	const MIDAS::EdgeFile data(pathBinary);
+	const int n = static_cast<int>(data.n);
+	const int* const source = data.source; // Zero-copy, points into the mapped file
+	const int* const destination = data.destination;
+	const int* const timestamp = data.timestamp;
 	printf("# Records = %d\t// Dataset is loaded\n", n);
 
 	// Call runner
@@ -350,16 +1190,56 @@ int main(int argc, char* argv[]) {
 	// NumColumnVsTime(n, numsColumn, 1000, numRepeat, source, destination, timestamp);
 	// NumColumnVsAUC(n, pathGroundTruth, numsColumn, 1000, numRepeat, source, destination, timestamp);
 
+	const auto numsColumnLayout = {1 << 10, 1 << 16, 1 << 20}; // Dense merges of 2^20 columns are slow, consider a prefix of the dataset
+	// LayoutVsTime(n, numsColumnLayout, 1000, numRepeat, source, destination, timestamp);
+
+	const auto numsRow = {1, 2, 3, 4};
+	// NumRowVsLatency(n, numColumn, 1000, numsRow, numRepeat, source, destination, timestamp);
+
+	const auto numsColumnKernel = {1 << 10, 1 << 14, 1 << 18, 1 << 22}; // L1, L2, LLC and DRAM on a typical CPU
+	// KernelVsBandwidth(numsColumnKernel, numRepeat);
+
+	const auto numsColumnStorage = {1 << 10, 1 << 16, 1 << 20, 1 << 22};
+	// StorageVsAUC(n, pathGroundTruth, numsColumnStorage, 1000, true, numRepeat, source, destination, timestamp);
+
+	const auto numsThread = {1, 2, 4, 8, 16, 32};
+	// NumThreadVsTime(n, 1 << 16, 1000, numsThread, numRepeat, source, destination, timestamp);
+	// SweepVsTime(n, numColumn, thresholds, numRepeat, source, destination, timestamp);
+
+	const auto numsTenant = {1, 16, 256, 4096};
+	// NumTenantVsTime(n, numColumn, 1000, numsTenant, numRepeat, source, destination, timestamp);
+	// SnapshotVsTime(n, 1 << 20, 1000, numRepeat, source, destination, timestamp);
+
+	const auto numsNode = {1, 2, 4, 8};
+	// NumNodeVsState(n, numColumn, numsNode, numRepeat, source, destination, timestamp);
+
+	const auto numsAttribute = {2, 3, 4, 6, 8};
+	// NumAttributeVsTime(n, numColumn, 1000, numsAttribute, numRepeat, source, destination, timestamp);
+
+	const auto numsTop = {10, 100, 1000};
+	// TopKVsTime(n, numColumn, 1000, numsTop, 0.5f, numRepeat, source, destination, timestamp);
+	// TopKVsBruteForce(numsTop, 0.5f, 1e10f, 400, numRepeat);
+
+	const auto numsProducer = {1, 2, 4, 8, 16};
+	// NumProducerVsThroughput(n, numColumn, 1000, numsProducer, numRepeat, source, destination, timestamp);
+
+	// StreamVsTime(pathData, numColumn, 1000, numRepeat);
+	// WindowVsAUC(n, pathGroundTruth, numColumn, 1000, 1 << 16, 1 << 12, source, destination, timestamp);
+
+	// KeyVsAUC(n, pathGroundTruth, numColumn, 1000, 1 << 16, numRepeat, source, destination, timestamp);
+
+	const std::vector<double> quantiles = {0.9, 0.99, 0.999, 0.9999};
+	// QuantileVsAlert(n, pathGroundTruth, numColumn, 1000, quantiles, numRepeat, source, destination, timestamp);
+
+	const auto latenesses = {0, 1, 2, 4, 8};
+	// LatenessVsAUC(n, pathGroundTruth, numColumn, 1000, 4, latenesses, numRepeat, source, destination, timestamp);
+
 	// Clean up
 	// --------------------------------------------------------------------------------
 	// All data exchanges are via files, so delete them after experiments
 	// If you wish to keep them, comment the lines below
 
 	char command[1024];
-	sprintf(command, "python %s %s", SOLUTION_DIR"util/DeleteTempFile.py", "Score*.txt AUC*.txt");
+	sprintf(command, "python %s %s", SOLUTION_DIR"util/DeleteTempFile.py", "Score*.bin");
 	system(command);
-
-	delete[] source;
-	delete[] destination;
-	delete[] timestamp;
 }
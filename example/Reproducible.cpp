@@ -14,11 +14,14 @@
 // limitations under the License.
 // -----------------------------------------------------------------------------
 
+#include <cstdio>
 #include <chrono>
-//
+
 #include "NormalCore.hpp"
 #include "RelationalCore.hpp"
 #include "FilteringCore.hpp"
+#include "EdgeFile.hpp"
+#include "ScoreSink.hpp"
 
 using namespace std::chrono;
 
@@ -26,8 +29,8 @@ int main(int argc, char* argv[]) {
 	// Parameter
 	// --------------------------------------------------------------------------------
 
-	const auto pathMeta = SOLUTION_DIR"data/DARPA/darpa_shape.txt";
 	const auto pathData = SOLUTION_DIR"data/DARPA/darpa_processed.csv";
+	const auto pathBinary = SOLUTION_DIR"data/DARPA/darpa_processed.bin";
 	const auto pathGroundTruth = SOLUTION_DIR"data/DARPA/darpa_ground_truth.csv";
 
 	// Random seed
@@ -37,25 +40,17 @@ int main(int argc, char* argv[]) {
 	printf("Seed = %u\t// In case of reproduction\n", seed);
 	srand(seed); // Many rand(), need to init
 
-	// Read meta (total number of records)
-	// --------------------------------------------------------------------------------
-	// PreprocessData.py will generate those meta files
-
-	const auto fileMeta = fopen(pathMeta, "r");
-	int n;
-	fscanf(fileMeta, "%d", &n);
-	fclose(fileMeta);
-
 	// Read dataset
 	// --------------------------------------------------------------------------------
-
-	const auto fileData = fopen(pathData, "r");
-	const auto source = new int[n];
-	const auto destination = new int[n];
-	const auto timestamp = new int[n];
-	for (int i = 0; i < n; i++)
-		fscanf(fileData, "%d,%d,%d", &source[i], &destination[i], &timestamp[i]);
-	fclose(fileData);
+	// The CSV from PreprocessData.py is converted to the binary format on the first run, later runs map the binary file directly
+
+	if (!MIDAS::EdgeFile(pathBinary).header)
+		MIDAS::ConvertEdgeFile(pathData, pathBinary);
+	const MIDAS::EdgeFile data(pathBinary);
+	const int n = static_cast<int>(data.n);
+	const int* const source = data.source; // Zero-copy, points into the mapped file
+	const int* const destination = data.destination;
+	const int* const timestamp = data.timestamp;
 	printf("# Records = %d\t// Dataset is loaded\n", n);
 
 	// Do the magic
@@ -104,10 +99,7 @@ int main(int argc, char* argv[]) {
 	// --------------------------------------------------------------------------------
 
 	const auto pathScore = SOLUTION_DIR"temp/Score.txt";
-	const auto fileScore = fopen(pathScore, "w");
-	for (int i = 0; i < n; i++)
-		fprintf(fileScore, "%f\n", score[i]);
-	fclose(fileScore);
+	MIDAS::TextScoreSink(pathScore).Write(score, n); // Same text as fprintf("%f\n")
 	printf("// Raw anomaly scores are exported to\n// " SOLUTION_DIR"temp/Score.txt\n");
 
 	// Evaluate scores
@@ -120,8 +112,5 @@ int main(int argc, char* argv[]) {
 	// Clean up
 	// --------------------------------------------------------------------------------
 
-	delete[] source;
-	delete[] destination;
-	delete[] timestamp;
 	delete[] score;
 }
@@ -0,0 +1,56 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace MIDAS {
+// A reusable barrier of a fixed number of threads, C++11 has none
+// Waiters spin a while, phases of a batch are short, then sleep, so idle threads cost nothing
+struct Barrier {
+	constexpr static int lenSpin = 1 << 10; // # yields before sleeping
+	const int n;
+	std::atomic<int> count;
+	std::atomic<unsigned> generation;
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	explicit Barrier(int numThread): n(numThread), count(0), generation(0) { }
+
+	void Wait() {
+		const unsigned g = generation.load(std::memory_order_acquire);
+		if (count.fetch_add(1, std::memory_order_acq_rel) == n - 1) { // The last one releases the others
+			count.store(0, std::memory_order_relaxed);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				generation.store(g + 1, std::memory_order_release);
+			}
+			condition.notify_all();
+			return;
+		}
+		for (int i = 0; i < lenSpin; i++) {
+			if (generation.load(std::memory_order_acquire) != g) return;
+			std::this_thread::yield();
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [&] { return generation.load(std::memory_order_acquire) != g; });
+	}
+};
+}
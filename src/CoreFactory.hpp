@@ -0,0 +1,99 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <memory>
+
+#include "NormalCore.hpp"
+#include "RelationalCore.hpp"
+#include "FilteringCore.hpp"
+
+namespace MIDAS {
+// Type-erased core, the number of rows is a runtime setting outside, but a compile-time constant inside
+// Prefer ScoreBatch(), the virtual call is paid once per batch instead of once per record
+struct AnyCore {
+	virtual ~AnyCore() { }
+	virtual float operator()(int source, int destination, int timestamp) = 0;
+	virtual void ScoreBatch(const int* source, const int* destination, const int* timestamp, float* scoreOut, size_t n) = 0;
+};
+
+template<class Core>
+struct AnyCoreOf: AnyCore {
+	Core core;
+
+	template<class... Args>
+	explicit AnyCoreOf(Args... args): core(args...) { }
+
+	float operator()(int source, int destination, int timestamp) override {
+		return core(source, destination, timestamp);
+	}
+
+	void ScoreBatch(const int* source, const int* destination, const int* timestamp, float* scoreOut, size_t n) override {
+		core.ScoreBatch(source, destination, timestamp, scoreOut, n);
+	}
+};
+
+// Pick the specialization of numRow, the ones not listed fall back to the runtime numRow (R = 0)
+// Policy: the template arguments after R, e.g., Hasher and Storage
+template<template<int, class...> class Core, class... Policy, class... Args>
+std::unique_ptr<AnyCore> MakeCore(Random random, int numRow, int numColumn, Args... args) {
+	switch (numRow) {
+		case 1:
+			return std::unique_ptr<AnyCore>(new AnyCoreOf<Core<1, Policy...>>(random, numRow, numColumn, args...));
+		case 2:
+			return std::unique_ptr<AnyCore>(new AnyCoreOf<Core<2, Policy...>>(random, numRow, numColumn, args...));
+		case 3:
+			return std::unique_ptr<AnyCore>(new AnyCoreOf<Core<3, Policy...>>(random, numRow, numColumn, args...));
+		case 4:
+			return std::unique_ptr<AnyCore>(new AnyCoreOf<Core<4, Policy...>>(random, numRow, numColumn, args...));
+		default:
+			return std::unique_ptr<AnyCore>(new AnyCoreOf<Core<0, Policy...>>(random, numRow, numColumn, args...));
+	}
+}
+
+// Each maker has a twin taking a Random first, like the constructors of cores
+
+template<class Hasher = ModuloHash, class Storage = FloatStorage>
+std::unique_ptr<AnyCore> MakeNormalCore(Random random, int numRow, int numColumn) {
+	return MakeCore<BasicNormalCore, Hasher, Storage>(random, numRow, numColumn);
+}
+
+template<class Hasher = ModuloHash, class Storage = FloatStorage>
+std::unique_ptr<AnyCore> MakeNormalCore(int numRow, int numColumn) {
+	return MakeNormalCore<Hasher, Storage>(Random(), numRow, numColumn);
+}
+
+template<class Hasher = ModuloHash, class Storage = FloatStorage>
+std::unique_ptr<AnyCore> MakeRelationalCore(Random random, int numRow, int numColumn, float factor = 0.5, bool lazy = false) {
+	return MakeCore<BasicRelationalCore, Hasher, Storage>(random, numRow, numColumn, factor, lazy);
+}
+
+template<class Hasher = ModuloHash, class Storage = FloatStorage>
+std::unique_ptr<AnyCore> MakeRelationalCore(int numRow, int numColumn, float factor = 0.5, bool lazy = false) {
+	return MakeRelationalCore<Hasher, Storage>(Random(), numRow, numColumn, factor, lazy);
+}
+
+template<class Hasher = ModuloHash, class Storage = FloatStorage, class ScoreStorage = Storage>
+std::unique_ptr<AnyCore> MakeFilteringCore(Random random, int numRow, int numColumn, float threshold, float factor = 0.5, bool incremental = false) {
+	return MakeCore<BasicFilteringCore, Hasher, Storage, ScoreStorage>(random, numRow, numColumn, threshold, factor, incremental);
+}
+
+template<class Hasher = ModuloHash, class Storage = FloatStorage, class ScoreStorage = Storage>
+std::unique_ptr<AnyCore> MakeFilteringCore(int numRow, int numColumn, float threshold, float factor = 0.5, bool incremental = false) {
+	return MakeFilteringCore<Hasher, Storage, ScoreStorage>(Random(), numRow, numColumn, threshold, factor, incremental);
+}
+}
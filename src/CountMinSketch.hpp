@@ -17,89 +17,197 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+
+#include "HashPolicy.hpp"
+#include "StoragePolicy.hpp"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MIDAS_PREFETCH(address) __builtin_prefetch(address, 1) // 1: for write
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#define MIDAS_PREFETCH(address) _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0)
+#else
+#define MIDAS_PREFETCH(address)
+#endif
 
 namespace MIDAS {
-struct CountMinSketch {
+// Indices of hashed cells, inline if the length N is known at compile time, otherwise on heap
+template<int N>
+struct IndexArray {
+	int index[N];
+
+	explicit IndexArray(int len) {
+		assert(len <= N); // Catches a compile-time R smaller than the runtime numRow
+		static_cast<void>(len); // Unused if NDEBUG
+	}
+
+	operator int*() { return index; }
+};
+
+template<>
+struct IndexArray<0> {
+	int* const index;
+
+	explicit IndexArray(int len): index(new int[len]) { }
+
+	IndexArray(const IndexArray& b) = delete;
+	IndexArray& operator=(const IndexArray& b) = delete;
+
+	~IndexArray() {
+		delete[] index;
+	}
+
+	operator int*() const { return index; }
+};
+
+// Memory of a CMS owned by someone else, e.g., a mapped snapshot, see Snapshot.hpp
+struct SketchView {
+	int numRow, numColumn;
+	void* param1;
+	void* param2;
+	void* data;
+};
+
+// R is the number of rows if known at compile time, so row loops can be unrolled, 0 means it's only known at runtime
+// Storage decides the type of cells, values are always read and written as float
+template<int R = 0, class Hasher = ModuloHash, class Storage = FloatStorage>
+struct BasicCountMinSketch {
 	// Fields
 	// --------------------------------------------------------------------------------
 
-	const int r, c, m = 104729; // Yes, a magic number, I just pick a random prime
+	typedef typename Hasher::Param Param;
+	typedef typename Storage::Cell Cell;
+	const int r, c;
+	const Hasher hasher;
 	const int lenData;
-	int* const param1;
-	int* const param2;
-	float* const data;
+	Param* const param1;
+	Param* const param2;
+	Cell* const data; // 64-byte aligned
+	const bool owner = true; // Whether param1, param2 and data are freed with the CMS
 	constexpr static float infinity = std::numeric_limits<float>::infinity();
 
 	// Methods
 	// --------------------------------------------------------------------------------
 
-	CountMinSketch() = delete;
-	CountMinSketch& operator=(const CountMinSketch& b) = delete;
+	BasicCountMinSketch() = delete;
+	BasicCountMinSketch& operator=(const BasicCountMinSketch& b) = delete;
 
-	CountMinSketch(int numRow, int numColumn):
+	// Hash parameters are drawn from random, the global rand() by default
+	BasicCountMinSketch(int numRow, int numColumn, Random& random = Random::Global()):
 		r(numRow),
 		c(numColumn),
+		hasher(numColumn),
 		lenData(r * c),
-		param1(new int[r]),
-		param2(new int[r]),
-		data(new float[lenData]) {
-		for (int i = 0; i < r; i++) {
-			param1[i] = rand() + 1; // ×0 is not a good idea, see Hash()
-			param2[i] = rand();
-		}
-		std::fill(data, data + lenData, 0);
+		param1(new Param[r]),
+		param2(new Param[r]),
+		data(Kernel::AlignedNew<Cell>(lenData)) {
+		assert(R == 0 || R == numRow);
+		for (int i = 0; i < r; i++)
+			Hasher::Draw(random, param1[i], param2[i]);
+		Storage::Fill(data, lenData, 0);
 	}
 
-	CountMinSketch(const CountMinSketch& b):
+	BasicCountMinSketch(const BasicCountMinSketch& b):
 		r(b.r),
 		c(b.c),
+		hasher(b.hasher),
 		lenData(b.lenData),
-		param1(new int[r]),
-		param2(new int[r]),
-		data(new float[lenData]) {
+		param1(new Param[r]),
+		param2(new Param[r]),
+		data(Kernel::AlignedNew<Cell>(lenData)) {
 		std::copy(b.param1, b.param1 + r, param1);
 		std::copy(b.param2, b.param2 + r, param2);
 		std::copy(b.data, b.data + lenData, data);
 	}
 
-	~CountMinSketch() {
+	// Parameters and cells are used in place, nothing is drawn, cleared or freed
+	explicit BasicCountMinSketch(const SketchView& view):
+		r(view.numRow),
+		c(view.numColumn),
+		hasher(view.numColumn),
+		lenData(r * c),
+		param1(static_cast<Param*>(view.param1)),
+		param2(static_cast<Param*>(view.param2)),
+		data(static_cast<Cell*>(view.data)),
+		owner(false) {
+		assert(R == 0 || R == view.numRow);
+	}
+
+	// Same hash parameters as b, cells are converted from another storage
+	template<class StorageOther>
+	explicit BasicCountMinSketch(const BasicCountMinSketch<R, Hasher, StorageOther>& b):
+		r(b.r),
+		c(b.c),
+		hasher(b.hasher),
+		lenData(b.lenData),
+		param1(new Param[r]),
+		param2(new Param[r]),
+		data(Kernel::AlignedNew<Cell>(lenData)) {
+		std::copy(b.param1, b.param1 + r, param1);
+		std::copy(b.param2, b.param2 + r, param2);
+		for (int i = 0; i < lenData; i++)
+			data[i] = Storage::Store(StorageOther::Load(b.data[i]));
+	}
+
+	~BasicCountMinSketch() {
+		if (!owner) return;
 		delete[] param1;
 		delete[] param2;
-		delete[] data;
+		Kernel::AlignedDelete(data);
+	}
+
+	int NumRow() const {
+		return R ? R : r;
 	}
 
 	void ClearAll(float with = 0) const {
-		std::fill(data, data + lenData, with);
+		Storage::Fill(data, lenData, with);
 	}
 
 	void MultiplyAll(float by) const {
-		for (int i = 0, I = lenData; i < I; i++) // Vectorization
-			data[i] *= by;
+		Storage::Scale(data, lenData, by);
 	}
 
 	void Hash(int* indexOut, int a, int b = 0) const {
-		for (int i = 0; i < r; i++) {
-			indexOut[i] = ((a + m * b) * param1[i] + param2[i]) % c;
-			indexOut[i] += i * c + (indexOut[i] < 0 ? c : 0);
-		}
+		for (int i = 0; i < NumRow(); i++)
+			indexOut[i] = i * c + hasher(a, b, param1[i], param2[i]);
+	}
+
+	void Prefetch(const int* index) const {
+		for (int i = 0; i < NumRow(); i++)
+			MIDAS_PREFETCH(data + index[i]);
 	}
 
 	float operator()(const int* index) const {
 		float least = infinity;
-		for (int i = 0; i < r; i++)
-			least = std::min(least, data[index[i]]);
+		for (int i = 0; i < NumRow(); i++)
+			least = std::min(least, Storage::Load(data[index[i]]));
 		return least;
 	}
 
 	float Assign(const int* index, float with) const {
-		for (int i = 0; i < r; i++)
-			data[index[i]] = with;
-		return with;
+		const Cell cell = Storage::Store(with);
+		for (int i = 0; i < NumRow(); i++)
+			data[index[i]] = cell;
+		return with; // Not rounded
 	}
 
 	void Add(const int* index, float by = 1) const {
-		for (int i = 0; i < r; i++)
-			data[index[i]] += by;
+		for (int i = 0; i < NumRow(); i++)
+			data[index[i]] = Storage::Store(Storage::Load(data[index[i]]) + by); // Saturated if the range is limited
+	}
+
+	// Cellwise data += b.data * by, b should have the same hash parameters, e.g., drawn from the same Random(seed)
+	// Counts of disjoint streams add up, so the result is the CMS of their union
+	void Merge(const BasicCountMinSketch& b, float by = 1) const {
+		assert(r == b.r && c == b.c && std::equal(param1, param1 + r, b.param1) && std::equal(param2, param2 + r, b.param2));
+		for (int i = 0; i < lenData; i++)
+			data[i] = Storage::Store(Storage::Load(data[i]) + Storage::Load(b.data[i]) * by);
 	}
 };
+
+typedef BasicCountMinSketch<> CountMinSketch;
 }
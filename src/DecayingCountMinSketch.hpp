@@ -0,0 +1,135 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cmath>
+
+#include "CountMinSketch.hpp"
+
+namespace MIDAS {
+// A CMS whose cells are multiplied by a constant factor on every Decay()
+// Eager: Decay() is MultiplyAll(), exactly the old behavior
+// Lazy: Decay() only bumps an epoch, a cell catches up with factor^(epoch - epochCell) when it is read or written
+template<int R = 0, class Hasher = ModuloHash, class Storage = FloatStorage>
+struct BasicDecayingCountMinSketch: BasicCountMinSketch<R, Hasher, Storage> {
+	// Fields
+	// --------------------------------------------------------------------------------
+
+	constexpr static int lenPower = 256; // Deltas beyond this fall back to pow()
+	const float factor;
+	int epoch = 0;
+	int* const epochCell; // Epoch of the last catch-up of each cell, nullptr if eager
+	float* const power; // factor^k, k in [0, lenPower), nullptr if eager
+
+	// Methods
+	// --------------------------------------------------------------------------------
+
+	BasicDecayingCountMinSketch(int numRow, int numColumn, float factor, bool lazy, Random& random = Random::Global()):
+		BasicCountMinSketch<R, Hasher, Storage>(numRow, numColumn, random),
+		factor(factor),
+		epochCell(lazy ? new int[this->lenData] : nullptr),
+		power(lazy ? new float[lenPower] : nullptr) {
+		if (lazy) {
+			std::fill(epochCell, epochCell + this->lenData, 0);
+			power[0] = 1;
+			for (int i = 1; i < lenPower; i++)
+				power[i] = power[i - 1] * factor; // Same rounding as repeated MultiplyAll()
+		}
+	}
+
+	// Cells are used in place, they should be flushed when saved, see Flush()
+	BasicDecayingCountMinSketch(const SketchView& view, float factor, bool lazy):
+		BasicCountMinSketch<R, Hasher, Storage>(view),
+		factor(factor),
+		epochCell(lazy ? new int[this->lenData] : nullptr),
+		power(lazy ? new float[lenPower] : nullptr) {
+		if (lazy) {
+			std::fill(epochCell, epochCell + this->lenData, 0);
+			power[0] = 1;
+			for (int i = 1; i < lenPower; i++)
+				power[i] = power[i - 1] * factor;
+		}
+	}
+
+	BasicDecayingCountMinSketch(const BasicDecayingCountMinSketch& b) = delete;
+
+	~BasicDecayingCountMinSketch() {
+		delete[] epochCell;
+		delete[] power;
+	}
+
+	float Power(int delta) const {
+		return delta < lenPower ? power[delta] : std::pow(factor, static_cast<float>(delta));
+	}
+
+	// times decays at once, i.e., factor^times, O(1) if lazy, one sweep if eager
+	void Decay(int times = 1) {
+		if (epochCell)
+			epoch += times; // O(1), independent of sketch width
+		else
+			this->MultiplyAll(times == 1 ? factor : std::pow(factor, static_cast<float>(times)));
+	}
+
+	void Touch(const int* index) const {
+		if (epochCell)
+			for (int i = 0; i < this->NumRow(); i++)
+				if (epochCell[index[i]] != epoch) {
+					this->data[index[i]] = Storage::Store(Storage::Load(this->data[index[i]]) * Power(epoch - epochCell[index[i]]));
+					epochCell[index[i]] = epoch;
+				}
+	}
+
+	void Flush() const { // Bring every cell up to date, e.g., before reading data directly
+		if (epochCell)
+			for (int i = 0; i < this->lenData; i++) {
+				this->data[i] = Storage::Store(Storage::Load(this->data[i]) * Power(epoch - epochCell[i]));
+				epochCell[i] = epoch;
+			}
+	}
+
+	// Pending decays of both are applied first
+	void Merge(const BasicDecayingCountMinSketch& b, float by = 1) const {
+		Flush();
+		b.Flush();
+		BasicCountMinSketch<R, Hasher, Storage>::Merge(b, by);
+	}
+
+	void Prefetch(const int* index) const {
+		BasicCountMinSketch<R, Hasher, Storage>::Prefetch(index);
+		if (epochCell)
+			for (int i = 0; i < this->NumRow(); i++)
+				MIDAS_PREFETCH(epochCell + index[i]);
+	}
+
+	float operator()(const int* index) const {
+		Touch(index);
+		return BasicCountMinSketch<R, Hasher, Storage>::operator()(index);
+	}
+
+	float Assign(const int* index, float with) const {
+		Touch(index); // Only for epochCell, the value is overwritten anyway
+		return BasicCountMinSketch<R, Hasher, Storage>::Assign(index, with);
+	}
+
+	void Add(const int* index, float by = 1) const {
+		Touch(index);
+		BasicCountMinSketch<R, Hasher, Storage>::Add(index, by);
+	}
+};
+
+typedef BasicDecayingCountMinSketch<> DecayingCountMinSketch;
+}
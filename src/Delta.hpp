@@ -0,0 +1,221 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "CountMinSketch.hpp"
+
+// Sketch deltas of a node of a distributed stream, all little-endian, a file or a socket is a sequence of messages
+// DeltaHeader, then for each CMS: uint32 numEntry, then numEntry DeltaEntry, the cells that changed since the previous message
+// CMSs are in the order of ForEachSketch() of the core, i.e., of snapshots
+// Every CMS of NormalCore and RelationalCore is linear in the edges, so an aggregator that adds up the deltas of all nodes
+// holds the sum of their cells, i.e., the totals of the whole stream, and its current counts too if every node calls
+// Advance(t) before writing the message of timestamp t, even if its slice has no edge at t
+
+namespace MIDAS {
+struct DeltaHeader {
+	char magic[8]; // "MIDASDLT"
+	uint32_t version;
+	int32_t numRow, numColumn;
+	uint32_t numSketch;
+	int32_t node; // Whoever wrote it
+	int32_t timestamp; // Of the core when it was written
+	uint64_t numEntry; // Of all CMSs
+};
+
+struct DeltaEntry {
+	uint32_t index; // Of the cell, row * numColumn + column
+	float value; // Added to the cell
+};
+
+constexpr char deltaMagic[8] = {'M', 'I', 'D', 'A', 'S', 'D', 'L', 'T'};
+constexpr uint32_t deltaVersion = 1;
+
+// Cells of a core changed since the previous message of its DeltaWriter, each with its value then, so a message costs O(changed cells)
+// The core calls Before() ahead of every write to its cells, only the first one since the message is recorded, a bit per cell tells
+struct DeltaLog {
+	int lenData = 0; // Of each CMS
+	std::vector<uint64_t> recorded; // A bit per cell of all CMSs
+	std::vector<std::vector<DeltaEntry>> before; // Per CMS, cells and their values as of the previous message
+
+	void Record(int k, int i, float value) {
+		const size_t j = static_cast<size_t>(k) * lenData + i;
+		if (recorded[j >> 6] >> (j & 63) & 1) return;
+		recorded[j >> 6] |= uint64_t(1) << (j & 63);
+		before[k].push_back({static_cast<uint32_t>(i), value});
+	}
+
+	// Cells of index in the k-th CMS
+	template<int R, class Hasher, class Storage>
+	void Before(int k, const BasicCountMinSketch<R, Hasher, Storage>& sketch, const int* index) {
+		for (int i = 0; i < sketch.NumRow(); i++)
+			Record(k, index[i], Storage::Load(sketch.data[index[i]]));
+	}
+
+	// All cells of the k-th CMS, e.g., before a decay or a merge
+	template<int R, class Hasher, class Storage>
+	void BeforeAll(int k, const BasicCountMinSketch<R, Hasher, Storage>& sketch) {
+		for (int i = 0; i < sketch.lenData; i++)
+			Record(k, i, Storage::Load(sketch.data[i]));
+	}
+};
+
+// Node side, attaches a DeltaLog to core, so the next message only has what changed since, core should outlive the writer
+// Core records its writes if it has a deltaLog, as NormalCore and RelationalCore do
+template<class Core>
+struct DeltaWriter {
+	Core& core;
+	const int node;
+	DeltaLog log;
+	std::vector<DeltaEntry> entry; // Of all CMSs of the message being written
+	std::vector<uint32_t> numEntry; // Per CMS
+	uint64_t numByte = 0; // Written so far
+
+	// Nothing is shipped yet, so nonzero cells, e.g., of a restored core, are recorded as 0
+	struct Attach {
+		DeltaLog& log;
+
+		template<int R, class Hasher, class Storage>
+		void operator()(const BasicCountMinSketch<R, Hasher, Storage>& sketch) {
+			const int k = static_cast<int>(log.before.size());
+			log.lenData = sketch.lenData;
+			log.before.emplace_back();
+			log.recorded.resize((static_cast<size_t>(k + 1) * sketch.lenData + 63) >> 6);
+			for (int i = 0; i < sketch.lenData; i++)
+				if (Storage::Load(sketch.data[i]) != 0)
+					log.Record(k, i, 0);
+		}
+	};
+
+	DeltaWriter(Core& core, int node): core(core), node(node) {
+		Attach attach = {log};
+		static_cast<const Core&>(core).ForEachSketch(attach);
+		core.deltaLog = &log;
+	}
+
+	DeltaWriter(const DeltaWriter& b) = delete;
+	DeltaWriter& operator=(const DeltaWriter& b) = delete;
+
+	~DeltaWriter() {
+		core.deltaLog = nullptr;
+	}
+
+	struct Collect {
+		DeltaWriter& writer;
+		DeltaHeader& header;
+
+		template<int R, class Hasher, class Storage>
+		void operator()(const BasicCountMinSketch<R, Hasher, Storage>& sketch) {
+			const uint32_t k = header.numSketch++;
+			DeltaLog& log = writer.log;
+			const size_t begin = writer.entry.size();
+			for (const DeltaEntry& b: log.before[k]) {
+				const float value = Storage::Load(sketch.data[b.index]);
+				if (value != b.value)
+					writer.entry.push_back({b.index, value - b.value});
+				const size_t j = static_cast<size_t>(k) * log.lenData + b.index;
+				log.recorded[j >> 6] &= ~(uint64_t(1) << (j & 63));
+			}
+			log.before[k].clear();
+			writer.numEntry.push_back(static_cast<uint32_t>(writer.entry.size() - begin));
+			header.numRow = sketch.r;
+			header.numColumn = sketch.c;
+		}
+	};
+
+	// Append a message to file, return false on I/O errors
+	bool Write(FILE* file) {
+		DeltaHeader header = {};
+		std::memcpy(header.magic, deltaMagic, sizeof(header.magic));
+		header.version = deltaVersion;
+		header.node = node;
+		header.timestamp = core.timestamp;
+		entry.clear();
+		numEntry.clear();
+		Collect collect = {*this, header};
+		static_cast<const Core&>(core).ForEachSketch(collect); // Lazy decays are flushed, the cells they change were recorded by Decay()
+		header.numEntry = entry.size();
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		for (uint32_t k = 0, i = 0; k < header.numSketch; i += numEntry[k++])
+			ok = ok && fwrite(&numEntry[k], sizeof(uint32_t), 1, file) == 1 && (numEntry[k] == 0 || fwrite(entry.data() + i, sizeof(DeltaEntry), numEntry[k], file) == numEntry[k]);
+		ok = ok && fflush(file) == 0;
+		numByte += sizeof(header) + sizeof(uint32_t) * header.numSketch + sizeof(DeltaEntry) * header.numEntry;
+		return ok;
+	}
+};
+
+// Checks that a message fits core before anything is added, see ApplyDelta()
+struct DeltaFit {
+	const DeltaHeader& header;
+	uint32_t numSketch;
+	int lenData;
+	bool ok;
+
+	template<int R, class Hasher, class Storage>
+	void operator()(const BasicCountMinSketch<R, Hasher, Storage>& sketch) {
+		ok = ok && numSketch++ < header.numSketch && sketch.r == header.numRow && sketch.c == header.numColumn;
+		lenData = sketch.lenData;
+	}
+};
+
+// Adds the entries of the next CMS of a message read by ApplyDelta()
+struct DeltaApply {
+	const DeltaEntry* entry;
+	const uint32_t* numEntry;
+
+	template<int R, class Hasher, class Storage>
+	void operator()(const BasicCountMinSketch<R, Hasher, Storage>& sketch) {
+		for (uint32_t i = 0; i < *numEntry; i++)
+			sketch.data[entry[i].index] = Storage::Store(Storage::Load(sketch.data[entry[i].index]) + entry[i].value);
+		entry += *numEntry++;
+	}
+};
+
+// Aggregator side, adds the next message of file to core, whose hash parameters should be those of the nodes
+// Its timestamp becomes the latest one it has seen, return false at the end of file, on I/O errors, or if the message does not fit core
+// The whole message is read and checked first, so core is left untouched on false, but the file position is not
+template<class Core>
+bool ApplyDelta(Core& core, FILE* file, DeltaHeader* headerOut = nullptr) {
+	DeltaHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, deltaMagic, sizeof(header.magic)) || header.version != deltaVersion)
+		return false;
+	DeltaFit fit = {header, 0, 0, true};
+	static_cast<const Core&>(core).ForEachSketch(fit);
+	if (!fit.ok || fit.numSketch != header.numSketch || header.numEntry > static_cast<uint64_t>(fit.numSketch) * fit.lenData) return false;
+	std::vector<uint32_t> numEntry(header.numSketch);
+	std::vector<DeltaEntry> entry(header.numEntry);
+	uint64_t m = 0; // Entries read so far
+	for (uint32_t k = 0; k < header.numSketch; k++) {
+		if (fread(&numEntry[k], sizeof(uint32_t), 1, file) != 1 || numEntry[k] > header.numEntry - m || (numEntry[k] && fread(entry.data() + m, sizeof(DeltaEntry), numEntry[k], file) != numEntry[k]))
+			return false;
+		m += numEntry[k];
+	}
+	if (m != header.numEntry) return false;
+	for (const DeltaEntry& e: entry)
+		if (e.index >= static_cast<uint32_t>(fit.lenData)) return false;
+	DeltaApply apply = {entry.data(), numEntry.data()};
+	core.ForEachSketch(apply);
+	if (core.timestamp < header.timestamp)
+		core.timestamp = header.timestamp; // Not Advance(), the deltas already carry the clearing or decay of current counts
+	if (headerOut) *headerOut = header;
+	return true;
+}
+}
@@ -0,0 +1,205 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "FilteringCore.hpp"
+
+namespace MIDAS {
+// Up to numTenant MIDAS-F detectors in one arena, a tenant is a slot of it, routed by its id
+// All cells of all tenants come from one allocation, aligned to a huge page, and so are the hash parameters of all tenants
+// Create() and Destroy() only pop and push a free list and clear the slot, no heap allocation after construction
+// If shareHash, every tenant uses the hash parameters drawn by the constructor, otherwise each draws its own in Create()
+// Scores of a tenant are the same as FilteringCore(numRow, numColumn, threshold, factor) with the same Random
+template<int R = 0, class Hasher = ModuloHash>
+struct BasicDetectorPool {
+	typedef typename Hasher::Param Param;
+
+	struct Tenant {
+		float threshold;
+		float factor;
+		int timestamp;
+		float timestampReciprocal;
+		bool alive;
+	};
+
+	constexpr static size_t alignmentArena = 1 << 21; // A huge page on x86-64
+	const int r, c;
+	const Hasher hasher;
+	const int numTenant;
+	const bool shareHash;
+	const int lenData;
+	const size_t lenStride; // lenData rounded up to a cache line
+	const size_t lenSlot; // Floats of a tenant, 9 CMSs
+	const size_t lenParam; // Params of a tenant, [edge/source/destination][param1/param2][row]
+	const size_t sizeArena; // Bytes
+	char* const arena; // [cells of all tenants][params of all tenants, or only one set if shareHash]
+	float* const data; // [tenant][edge/source/destination][current/total/score][cell]
+	Param* const param;
+	Tenant* const tenant;
+	int* const idFree; // Stack of free ids
+	int numFree;
+	IndexArray<R> indexEdge;
+	IndexArray<R> indexSource;
+	IndexArray<R> indexDestination;
+
+	BasicDetectorPool(Random random, int numTenant, int numRow, int numColumn, bool shareHash = true):
+		r(numRow),
+		c(numColumn),
+		hasher(numColumn),
+		numTenant(numTenant),
+		shareHash(shareHash),
+		lenData(numRow * numColumn),
+		lenStride((lenData + Kernel::alignment / sizeof(float) - 1) / (Kernel::alignment / sizeof(float)) * (Kernel::alignment / sizeof(float))),
+		lenSlot(9 * lenStride),
+		lenParam(6ull * numRow),
+		sizeArena(((sizeof(float) * lenSlot * numTenant + sizeof(Param) * lenParam * (shareHash ? 1 : numTenant)) + alignmentArena - 1) / alignmentArena * alignmentArena),
+		arena(AllocateArena(sizeArena)),
+		data(reinterpret_cast<float*>(arena)),
+		param(reinterpret_cast<Param*>(arena + sizeof(float) * lenSlot * numTenant)), // lenSlot * 4 is a multiple of 64, so params are aligned
+		tenant(new Tenant[numTenant]),
+		idFree(new int[numTenant]),
+		numFree(numTenant),
+		indexEdge(numRow),
+		indexSource(numRow),
+		indexDestination(numRow) {
+		assert(R == 0 || R == numRow);
+		for (int i = 0; i < numTenant; i++) {
+			tenant[i].alive = false;
+			idFree[i] = numTenant - 1 - i; // Ids are handed out from 0
+		}
+		if (shareHash)
+			Draw(param, random);
+	}
+
+	BasicDetectorPool(int numTenant, int numRow, int numColumn, bool shareHash = true):
+		BasicDetectorPool(Random(), numTenant, numRow, numColumn, shareHash) { }
+
+	BasicDetectorPool(const BasicDetectorPool& b) = delete;
+	BasicDetectorPool& operator=(const BasicDetectorPool& b) = delete;
+
+	virtual ~BasicDetectorPool() {
+		Kernel::AlignedDelete(arena);
+		delete[] tenant;
+		delete[] idFree;
+	}
+
+	// Freed by Kernel::AlignedDelete(), throws std::bad_alloc as new[] does
+	static char* AllocateArena(size_t size) {
+#ifdef _MSC_VER
+		void* const p = _aligned_malloc(size ? size : alignmentArena, alignmentArena);
+		if (!p) throw std::bad_alloc();
+#else
+		void* p = nullptr;
+		if (posix_memalign(&p, alignmentArena, size ? size : alignmentArena)) throw std::bad_alloc();
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+		madvise(p, size, MADV_HUGEPAGE); // Only a hint, transparent huge pages may be disabled
+#endif
+#endif
+		return static_cast<char*>(p);
+	}
+
+	int NumRow() const {
+		return R ? R : r;
+	}
+
+	int NumAlive() const {
+		return numTenant - numFree;
+	}
+
+	// Same order of draws as the CMSs of FilteringCore, edge, source, then destination
+	void Draw(Param* p, Random& random) const {
+		for (int f = 0; f < 3; f++)
+			for (int i = 0; i < r; i++)
+				Hasher::Draw(random, p[2 * f * r + i], p[(2 * f + 1) * r + i]);
+	}
+
+	// The id of a new tenant, or -1 if the pool is full, random is only used if not shareHash
+	int Create(float threshold, float factor = 0.5, Random random = Random()) {
+		if (!numFree) return -1;
+		const int id = idFree[--numFree];
+		tenant[id] = {threshold, factor, 1, 0, true};
+		Kernel::Fill(Data(id, 0, 0), lenSlot, 0);
+		if (!shareHash)
+			Draw(ParamOf(id), random);
+		return id;
+	}
+
+	void Destroy(int id) {
+		assert(tenant[id].alive);
+		tenant[id].alive = false;
+		idFree[numFree++] = id;
+	}
+
+	// f: 0 edge, 1 source, 2 destination, kind: 0 current, 1 total, 2 score
+	float* Data(int id, int f, int kind) const {
+		return data + id * lenSlot + (f * 3 + kind) * lenStride;
+	}
+
+	Param* ParamOf(int id) const {
+		return param + (shareHash ? 0 : id * lenParam);
+	}
+
+	void Hash(int id, int* indexOut, int f, int a, int b = 0) const {
+		const Param* const p = ParamOf(id) + 2 * f * r;
+		for (int i = 0; i < NumRow(); i++)
+			indexOut[i] = i * c + hasher(a, b, p[i], p[r + i]);
+	}
+
+	// FilteringCore::Score() with the dense merge, see FilteringCore::Update()
+	float Score(int id, const int* indexEdge, const int* indexSource, const int* indexDestination, int timestamp) {
+		Tenant& t = tenant[id];
+		assert(t.alive);
+		if (t.timestamp < timestamp) {
+			for (int f = 0; f < 3; f++)
+				Kernel::ConditionalMerge(Data(id, f, 0), Data(id, f, 1), Data(id, f, 2), lenData, t.threshold, t.timestampReciprocal, t.factor);
+			t.timestampReciprocal = 1.f / (timestamp - 1);
+			t.timestamp = timestamp;
+		}
+		const int* const index[3] = {indexEdge, indexSource, indexDestination};
+		float score = 0;
+		for (int f = 0; f < 3; f++) {
+			const float v = BasicFilteringCore<R, Hasher>::Update(Data(id, f, 0), Data(id, f, 1), Data(id, f, 2), index[f], r, timestamp);
+			score = f ? std::max(score, v) : v;
+		}
+		return score;
+	}
+
+	float operator()(int id, int source, int destination, int timestamp) {
+		Hash(id, indexEdge, 0, source, destination);
+		Hash(id, indexSource, 1, source);
+		Hash(id, indexDestination, 2, destination);
+		return Score(id, indexEdge, indexSource, indexDestination, timestamp);
+	}
+
+	// Edges of different tenants may be interleaved, each tenant's timestamps should be non-decreasing
+	void ScoreBatch(const int* id, const int* source, const int* destination, const int* timestamp, float* scoreOut, size_t n) {
+		for (size_t i = 0; i < n; i++)
+			scoreOut[i] = (*this)(id[i], source[i], destination[i], timestamp[i]);
+	}
+};
+
+typedef BasicDetectorPool<> DetectorPool;
+}
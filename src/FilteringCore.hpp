@@ -17,82 +17,302 @@
 #pragma once
 
 #include <cmath>
+#include <type_traits>
 
-#include "CountMinSketch.hpp"
+#include "Snapshot.hpp"
 
 namespace MIDAS {
-struct FilteringCore {
+// Storage is for count CMSs, ScoreStorage is for score CMSs, whose values only need to be compared with the threshold
+template<int R = 0, class Hasher = ModuloHash, class Storage = FloatStorage, class ScoreStorage = Storage>
+struct BasicFilteringCore {
+	typedef typename Storage::Cell Cell;
+	typedef typename ScoreStorage::Cell ScoreCell;
 	const float threshold;
 	int timestamp = 1;
 	const float factor;
 	const int lenData;
-	int* const indexEdge; // Pre-compute the index to-be-modified, thanks to the Same-Layout Assumption
-	int* const indexSource;
-	int* const indexDestination;
-	CountMinSketch numCurrentEdge, numTotalEdge, scoreEdge;
-	CountMinSketch numCurrentSource, numTotalSource, scoreSource;
-	CountMinSketch numCurrentDestination, numTotalDestination, scoreDestination;
+	IndexArray<R> indexEdge; // Pre-compute the index to-be-modified, thanks to the Same-Layout Assumption
+	IndexArray<R> indexSource;
+	IndexArray<R> indexDestination;
+	BasicCountMinSketch<R, Hasher, Storage> numCurrentEdge, numTotalEdge;
+	BasicCountMinSketch<R, Hasher, ScoreStorage> scoreEdge;
+	BasicCountMinSketch<R, Hasher, Storage> numCurrentSource, numTotalSource;
+	BasicCountMinSketch<R, Hasher, ScoreStorage> scoreSource;
+	BasicCountMinSketch<R, Hasher, Storage> numCurrentDestination, numTotalDestination;
+	BasicCountMinSketch<R, Hasher, ScoreStorage> scoreDestination;
 	float timestampReciprocal = 0;
-	bool* const shouldMerge;
+	constexpr static int lenBatch = 256; // # edges hashed ahead by ScoreBatch()
+	constexpr static int distancePrefetch = 16; // # edges prefetched ahead by ScoreBatch()
+	IndexArray<3 * lenBatch * R> indexBatch; // Edge, source, destination, each has lenBatch * numRow
 
-	FilteringCore(int numRow, int numColumn, float threshold, float factor = 0.5):
+	// Incremental merge, a cell replays the merges it missed when it is accessed, instead of every cell being merged on every tick
+	constexpr static int lenHistory = 1 << 16; // Every cell is synchronized when the history is full
+	const bool incremental;
+	int tick = 0; // # ticks since the last synchronization
+	float* const historyReciprocal; // timestampReciprocal of each tick
+	int* const tickEdge; // The tick each cell has caught up with
+	int* const tickSource;
+	int* const tickDestination;
+
+	// If incremental, a tick costs O(1) instead of O(numRow * numColumn), and scores are exactly the same
+	BasicFilteringCore(int numRow, int numColumn, float threshold, float factor = 0.5, bool incremental = false):
+		BasicFilteringCore(Random(), numRow, numColumn, threshold, factor, incremental) { }
+
+	// Hash parameters are drawn from random instead of the global rand(), e.g., Random(seed)
+	BasicFilteringCore(Random random, int numRow, int numColumn, float threshold, float factor = 0.5, bool incremental = false):
 		threshold(threshold),
 		factor(factor),
 		lenData(numRow * numColumn), // I assume all CMSs have same size, but Same-Layout Assumption is not that strict
-		indexEdge(new int[numRow]),
-		indexSource(new int[numRow]),
-		indexDestination(new int[numRow]),
-		numCurrentEdge(numRow, numColumn),
+		indexEdge(numRow),
+		indexSource(numRow),
+		indexDestination(numRow),
+		numCurrentEdge(numRow, numColumn, random),
 		numTotalEdge(numCurrentEdge),
 		scoreEdge(numCurrentEdge),
-		numCurrentSource(numRow, numColumn),
+		numCurrentSource(numRow, numColumn, random),
 		numTotalSource(numCurrentSource),
 		scoreSource(numCurrentSource),
-		numCurrentDestination(numRow, numColumn),
+		numCurrentDestination(numRow, numColumn, random),
 		numTotalDestination(numCurrentDestination),
 		scoreDestination(numCurrentDestination),
-		shouldMerge(new bool[numRow * numColumn]) { }
+		indexBatch(3 * lenBatch * numRow),
+		incremental(incremental),
+		historyReciprocal(incremental ? new float[lenHistory] : nullptr),
+		tickEdge(incremental ? new int[lenData] : nullptr),
+		tickSource(incremental ? new int[lenData] : nullptr),
+		tickDestination(incremental ? new int[lenData] : nullptr) {
+		if (incremental) {
+			std::fill(tickEdge, tickEdge + lenData, 0);
+			std::fill(tickSource, tickSource + lenData, 0);
+			std::fill(tickDestination, tickDestination + lenData, 0);
+		}
+	}
+
+	// Restore from a snapshot, cells are used in place, so the snapshot should outlive the core, check Fits() first
+	explicit BasicFilteringCore(const Snapshot& snapshot, bool incremental = false):
+		threshold(snapshot.header->threshold),
+		timestamp(snapshot.header->timestamp),
+		factor(snapshot.header->factor),
+		lenData(snapshot.header->numRow * snapshot.header->numColumn),
+		indexEdge(snapshot.header->numRow),
+		indexSource(snapshot.header->numRow),
+		indexDestination(snapshot.header->numRow),
+		numCurrentEdge(snapshot.View(0)),
+		numTotalEdge(snapshot.View(1)),
+		scoreEdge(snapshot.View(2)),
+		numCurrentSource(snapshot.View(3)),
+		numTotalSource(snapshot.View(4)),
+		scoreSource(snapshot.View(5)),
+		numCurrentDestination(snapshot.View(6)),
+		numTotalDestination(snapshot.View(7)),
+		scoreDestination(snapshot.View(8)),
+		timestampReciprocal(snapshot.header->timestampReciprocal),
+		indexBatch(3 * lenBatch * snapshot.header->numRow),
+		incremental(incremental),
+		historyReciprocal(incremental ? new float[lenHistory] : nullptr),
+		tickEdge(incremental ? new int[lenData] : nullptr),
+		tickSource(incremental ? new int[lenData] : nullptr),
+		tickDestination(incremental ? new int[lenData] : nullptr) {
+		if (incremental) {
+			std::fill(tickEdge, tickEdge + lenData, 0);
+			std::fill(tickSource, tickSource + lenData, 0);
+			std::fill(tickDestination, tickDestination + lenData, 0);
+		}
+	}
+
+	virtual ~BasicFilteringCore() {
+		delete[] historyReciprocal;
+		delete[] tickEdge;
+		delete[] tickSource;
+		delete[] tickDestination;
+	}
+
+	static bool Fits(const Snapshot& snapshot) {
+		const uint32_t i = Storage::id, j = ScoreStorage::id, c = sizeof(Cell), s = sizeof(ScoreCell);
+		const uint32_t storage[] = {i, i, j, i, i, j, i, i, j};
+		const uint32_t sizeCell[] = {c, c, s, c, c, s, c, c, s};
+		return snapshot.Fits(SnapshotFiltering, 9, Hasher::id, sizeof(typename Hasher::Param), storage, sizeCell) && (R == 0 || R == snapshot.header->numRow);
+	}
 
-	virtual ~FilteringCore() {
-		delete[] indexEdge;
-		delete[] indexSource;
-		delete[] indexDestination;
-		delete[] shouldMerge;
+	// Hash parameters, timestamp, threshold, factor and cells, incremental merges are caught up first, see SaveSnapshot() and SaveInBackground()
+	void Plan(SnapshotPlan& plan) {
+		Synchronize();
+		plan.Begin(SnapshotFiltering, numCurrentEdge.NumRow(), numCurrentEdge.c, timestamp, timestampReciprocal, threshold, factor);
+		plan.Add(numCurrentEdge);
+		plan.Add(numTotalEdge);
+		plan.Add(scoreEdge);
+		plan.Add(numCurrentSource);
+		plan.Add(numTotalSource);
+		plan.Add(scoreSource);
+		plan.Add(numCurrentDestination);
+		plan.Add(numTotalDestination);
+		plan.Add(scoreDestination);
 	}
 
 	static float ComputeScore(float a, float s, float t) {
 		return s == 0 ? 0 : pow(a + s - a * t, 2) / (s * (t - 1)); // If t == 1, then s == 0, so no need to check twice
 	}
 
-	void ConditionalMerge(const float* current, float* total, const float* score) const {
-		for (int i = 0; i < lenData; i++)
-			shouldMerge[i] = score[i] < threshold;
-		for (int i = 0, I = lenData; i < I; i++) // Vectorization
-			total[i] += shouldMerge[i] * current[i] + (true - shouldMerge[i]) * total[i] * timestampReciprocal;
+	// The update of a CMS family by a record, shared by every MIDAS-F core, so their scores stay the same bit by bit:
+	// add 1 to the hashed cells of current, score by the least current and total counts over rows, then assign it to the hashed cells of score
+	// lenLane records side by side, cell i of lane k is at index[i] * stride + k, e.g., configurations of SweepFilteringCore, loops over lanes vectorize
+	// scoreOut gets lenLane scores, not rounded by ScoreStorage
+	template<int lenLane>
+	static void Update(Cell* current, const Cell* total, ScoreCell* score, const int* index, int numRow, int timestamp, size_t stride, float* scoreOut) {
+		float a[lenLane], s[lenLane];
+		std::fill(a, a + lenLane, float(BasicCountMinSketch<R, Hasher>::infinity)); // A copy, so C++11 needs no definition
+		std::fill(s, s + lenLane, float(BasicCountMinSketch<R, Hasher>::infinity));
+		for (int i = 0; i < (R ? R : numRow); i++) {
+			Cell* const c = current + index[i] * stride;
+			const Cell* const t = total + index[i] * stride;
+			for (int k = 0; k < lenLane; k++) {
+				c[k] = Storage::Store(Storage::Load(c[k]) + 1); // Saturated if the range is limited
+				a[k] = std::min(a[k], Storage::Load(c[k]));
+				s[k] = std::min(s[k], Storage::Load(t[k]));
+			}
+		}
+		ScoreCell v[lenLane];
+		for (int k = 0; k < lenLane; k++) {
+			scoreOut[k] = ComputeScore(a[k], s[k], timestamp);
+			v[k] = ScoreStorage::Store(scoreOut[k]);
+		}
+		for (int i = 0; i < (R ? R : numRow); i++)
+			std::copy(v, v + lenLane, score + index[i] * stride);
 	}
 
-	float operator()(int source, int destination, int timestamp) {
+	// A single record, returns its score
+	static float Update(Cell* current, const Cell* total, ScoreCell* score, const int* index, int numRow, int timestamp) {
+		float v;
+		Update<1>(current, total, score, index, numRow, timestamp, 1, &v);
+		return v;
+	}
+
+	// Merge and decay in one sweep, so the current CMS is only read and written once per tick
+	// For each cell, total += shouldMerge * current + (1 - shouldMerge) * total * timestampReciprocal, then current *= factor
+	void ConditionalMerge(Cell* current, Cell* total, const ScoreCell* score) const {
+		ConditionalMerge(current, total, score, std::integral_constant<bool, std::is_same<Storage, FloatStorage>::value && std::is_same<ScoreStorage, FloatStorage>::value>());
+	}
+
+	void ConditionalMerge(float* current, float* total, const float* score, std::true_type) const { // All in float, SIMD
+		Kernel::ConditionalMerge(current, total, score, lenData, threshold, timestampReciprocal, factor);
+	}
+
+	void ConditionalMerge(Cell* current, Cell* total, const ScoreCell* score, std::false_type) const {
+		for (int i = 0, I = lenData; i < I; i++) {
+			const float a = Storage::Load(current[i]);
+			const float s = Storage::Load(total[i]);
+			const float shouldMerge = ScoreStorage::Load(score[i]) < threshold;
+			total[i] = Storage::Store(s + (shouldMerge * a + (1 - shouldMerge) * s * timestampReciprocal));
+			current[i] = Storage::Store(a * factor);
+		}
+	}
+
+	// Replay the merges a cell missed, same arithmetic as ConditionalMerge(), so same result bit by bit with FloatStorage
+	// Other storages only round once at the end, instead of once per tick, so results differ from the dense merge by rounding errors
+	void CatchUp(int i, int* tickCell, Cell* current, Cell* total, const ScoreCell* score) const {
+		const float shouldMerge = ScoreStorage::Load(score[i]) < threshold; // Score only changes when the cell is accessed
+		float a = Storage::Load(current[i]);
+		float s = Storage::Load(total[i]);
+		for (int k = tickCell[i]; k < tick; k++) {
+			if (a == 0 && (shouldMerge || s == 0)) break; // Fixed point, the remaining merges change nothing
+			s += shouldMerge * a + (1 - shouldMerge) * s * historyReciprocal[k];
+			a *= factor;
+		}
+		current[i] = Storage::Store(a);
+		total[i] = Storage::Store(s);
+		tickCell[i] = tick;
+	}
+
+	void CatchUp(const int* index, int* tickCell, Cell* current, Cell* total, const ScoreCell* score) const {
+		for (int i = 0; i < numCurrentEdge.NumRow(); i++)
+			CatchUp(index[i], tickCell, current, total, score);
+	}
+
+	// Bring every cell up to date, call it before reading the data of CMSs directly
+	void Synchronize() {
+		if (!incremental) return;
+		for (int i = 0; i < lenData; i++) {
+			CatchUp(i, tickEdge, numCurrentEdge.data, numTotalEdge.data, scoreEdge.data);
+			CatchUp(i, tickSource, numCurrentSource.data, numTotalSource.data, scoreSource.data);
+			CatchUp(i, tickDestination, numCurrentDestination.data, numTotalDestination.data, scoreDestination.data);
+		}
+		tick = 0;
+		std::fill(tickEdge, tickEdge + lenData, 0);
+		std::fill(tickSource, tickSource + lenData, 0);
+		std::fill(tickDestination, tickDestination + lenData, 0);
+	}
+
+	float Score(const int* indexEdge, const int* indexSource, const int* indexDestination, int timestamp) {
 		if (this->timestamp < timestamp) {
-			ConditionalMerge(numCurrentEdge.data, numTotalEdge.data, scoreEdge.data);
-			ConditionalMerge(numCurrentSource.data, numTotalSource.data, scoreSource.data);
-			ConditionalMerge(numCurrentDestination.data, numTotalDestination.data, scoreDestination.data);
-			numCurrentEdge.MultiplyAll(factor);
-			numCurrentSource.MultiplyAll(factor);
-			numCurrentDestination.MultiplyAll(factor);
+			if (incremental) {
+				if (tick == lenHistory)
+					Synchronize();
+				historyReciprocal[tick++] = timestampReciprocal;
+			} else {
+				ConditionalMerge(numCurrentEdge.data, numTotalEdge.data, scoreEdge.data);
+				ConditionalMerge(numCurrentSource.data, numTotalSource.data, scoreSource.data);
+				ConditionalMerge(numCurrentDestination.data, numTotalDestination.data, scoreDestination.data);
+			}
 			timestampReciprocal = 1.f / (timestamp - 1); // So I can skip an if-statement
 			this->timestamp = timestamp;
 		}
+		if (incremental) {
+			CatchUp(indexEdge, tickEdge, numCurrentEdge.data, numTotalEdge.data, scoreEdge.data);
+			CatchUp(indexSource, tickSource, numCurrentSource.data, numTotalSource.data, scoreSource.data);
+			CatchUp(indexDestination, tickDestination, numCurrentDestination.data, numTotalDestination.data, scoreDestination.data);
+		}
+		const int r = numCurrentEdge.NumRow();
+		return std::max({
+			Update(numCurrentEdge.data, numTotalEdge.data, scoreEdge.data, indexEdge, r, timestamp),
+			Update(numCurrentSource.data, numTotalSource.data, scoreSource.data, indexSource, r, timestamp),
+			Update(numCurrentDestination.data, numTotalDestination.data, scoreDestination.data, indexDestination, r, timestamp),
+		});
+	}
+
+	float operator()(int source, int destination, int timestamp) {
 		numCurrentEdge.Hash(indexEdge, source, destination);
-		numCurrentEdge.Add(indexEdge);
 		numCurrentSource.Hash(indexSource, source);
-		numCurrentSource.Add(indexSource);
 		numCurrentDestination.Hash(indexDestination, destination);
-		numCurrentDestination.Add(indexDestination);
-		return std::max({
-			scoreEdge.Assign(indexEdge, ComputeScore(numCurrentEdge(indexEdge), numTotalEdge(indexEdge), timestamp)),
-			scoreSource.Assign(indexSource, ComputeScore(numCurrentSource(indexSource), numTotalSource(indexSource), timestamp)),
-			scoreDestination.Assign(indexDestination, ComputeScore(numCurrentDestination(indexDestination), numTotalDestination(indexDestination), timestamp)),
-		});
+		return Score(indexEdge, indexSource, indexDestination, timestamp);
+	}
+
+	// Same scores as calling operator() on each edge, but hashing is done ahead so cells can be prefetched
+	void ScoreBatch(const int* source, const int* destination, const int* timestamp, float* scoreOut, size_t n) {
+		const int r = numCurrentEdge.NumRow();
+		int* const indexEdge = indexBatch;
+		int* const indexSource = indexBatch + lenBatch * r;
+		int* const indexDestination = indexBatch + 2 * lenBatch * r;
+		for (size_t i = 0; i < n; i += lenBatch) {
+			const int m = static_cast<int>(std::min<size_t>(lenBatch, n - i));
+			for (int j = 0; j < m; j++) {
+				numCurrentEdge.Hash(indexEdge + j * r, source[i + j], destination[i + j]);
+				numCurrentSource.Hash(indexSource + j * r, source[i + j]);
+				numCurrentDestination.Hash(indexDestination + j * r, destination[i + j]);
+			}
+			for (int j = 0; j < m; j++) {
+				if (j + distancePrefetch < m) {
+					const int k = (j + distancePrefetch) * r;
+					numCurrentEdge.Prefetch(indexEdge + k);
+					numTotalEdge.Prefetch(indexEdge + k);
+					scoreEdge.Prefetch(indexEdge + k);
+					numCurrentSource.Prefetch(indexSource + k);
+					numTotalSource.Prefetch(indexSource + k);
+					scoreSource.Prefetch(indexSource + k);
+					numCurrentDestination.Prefetch(indexDestination + k);
+					numTotalDestination.Prefetch(indexDestination + k);
+					scoreDestination.Prefetch(indexDestination + k);
+					if (incremental)
+						for (int l = 0; l < r; l++) {
+							MIDAS_PREFETCH(tickEdge + indexEdge[k + l]);
+							MIDAS_PREFETCH(tickSource + indexSource[k + l]);
+							MIDAS_PREFETCH(tickDestination + indexDestination[k + l]);
+						}
+				}
+				scoreOut[i + j] = Score(indexEdge + j * r, indexSource + j * r, indexDestination + j * r, timestamp[i + j]);
+			}
+		}
 	}
 };
+
+typedef BasicFilteringCore<> FilteringCore;
 }
@@ -0,0 +1,115 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cassert>
+
+#include "CountMinSketch.hpp"
+#include "Kernel.hpp"
+
+namespace MIDAS {
+// Three CMSs (current, total, score) sharing one set of hash parameters, stored cell-interleaved
+// Every 5 adjacent cells form a bucket of 15 floats and one of padding, exactly one cache line,
+// so a hashed cell costs one miss instead of three, and only 1/16 of the memory is padding
+// Hash() gives float offsets into data, so current, total and score of a cell are Current()[i], Total()[i] and Score()[i],
+// which is the layout FilteringCore::Update() takes
+template<int R = 0, class Hasher = ModuloHash>
+struct BasicFusedCountMinSketch {
+	// Fields
+	// --------------------------------------------------------------------------------
+
+	typedef typename Hasher::Param Param;
+	constexpr static int lenLane = Kernel::lenBucketLane;
+	constexpr static int lenBucket = Kernel::lenBucket;
+	static_assert(3 * lenLane <= lenBucket, "A bucket should fit in one cache line");
+
+	const int r, c;
+	const Hasher hasher; // Same hash as CountMinSketch, so the same parameters give the same cells
+	const int lenData; // # cells
+	const int numBucket;
+	Param* const param1;
+	Param* const param2;
+	float* const data; // numBucket buckets of [current/total/score][lane], 64-byte aligned
+
+	// Methods
+	// --------------------------------------------------------------------------------
+
+	BasicFusedCountMinSketch() = delete;
+	BasicFusedCountMinSketch(const BasicFusedCountMinSketch& b) = delete;
+	BasicFusedCountMinSketch& operator=(const BasicFusedCountMinSketch& b) = delete;
+
+	// Same draws as BasicCountMinSketch
+	BasicFusedCountMinSketch(int numRow, int numColumn, Random& random = Random::Global()):
+		r(numRow),
+		c(numColumn),
+		hasher(numColumn),
+		lenData(r * c),
+		numBucket((lenData + lenLane - 1) / lenLane),
+		param1(new Param[r]),
+		param2(new Param[r]),
+		data(Kernel::AlignedNew<float>(size_t(numBucket) * lenBucket)) {
+		assert(R == 0 || R == numRow);
+		for (int i = 0; i < r; i++)
+			Hasher::Draw(random, param1[i], param2[i]);
+		Kernel::Fill(data, size_t(numBucket) * lenBucket, 0);
+	}
+
+	~BasicFusedCountMinSketch() {
+		delete[] param1;
+		delete[] param2;
+		Kernel::AlignedDelete(data);
+	}
+
+	int NumRow() const {
+		return R ? R : r;
+	}
+
+	float* Current() const {
+		return data;
+	}
+
+	float* Total() const {
+		return data + lenLane;
+	}
+
+	float* Score() const {
+		return data + 2 * lenLane;
+	}
+
+	// Offset of a cell, i.e., of its current count
+	static int Offset(int cell) {
+		return cell / lenLane * lenBucket + cell % lenLane;
+	}
+
+	void Hash(int* indexOut, int a, int b = 0) const {
+		for (int i = 0; i < NumRow(); i++)
+			indexOut[i] = Offset(i * c + hasher(a, b, param1[i], param2[i]));
+	}
+
+	void Prefetch(const int* index) const {
+		for (int i = 0; i < NumRow(); i++)
+			MIDAS_PREFETCH(data + index[i]);
+	}
+
+	// Same arithmetic as Kernel::ConditionalMerge() on separate CMSs, so same result bit by bit
+	void ConditionalMerge(float threshold, float timestampReciprocal, float factor) const {
+		Kernel::ConditionalMergeBucket(data, numBucket, threshold, timestampReciprocal, factor);
+	}
+};
+
+typedef BasicFusedCountMinSketch<> FusedCountMinSketch;
+}
@@ -0,0 +1,102 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+
+#include "Random.hpp"
+
+// A hash policy maps (a, b) to a column in [0, numColumn), each row has its own (param1, param2)
+// - typedef Param: type of param1 and param2
+// - constexpr static uint32_t id: saved in snapshots, so a core is only restored with the policy it was saved with
+// - static void Draw(Random& random, Param& param1, Param& param2): random parameters of a row
+// - explicit constructor from numColumn
+// - int operator()(int a, int b, Param param1, Param param2) const
+
+namespace MIDAS {
+// The original hash, signed 32-bit with a modulo, keep it to reproduce old results
+struct ModuloHash {
+	typedef int Param;
+	constexpr static uint32_t id = 1;
+	const int c, m = 104729; // Yes, a magic number, I just pick a random prime
+
+	explicit ModuloHash(int numColumn): c(numColumn) { }
+
+	static void Draw(Random& random, Param& param1, Param& param2) {
+		param1 = random() + 1; // ×0 is not a good idea
+		param2 = random();
+	}
+
+	// Wraps around in unsigned arithmetic, same columns as the signed overflow of old compilers, but defined for any id, e.g., from KeyHash
+	int operator()(int a, int b, Param param1, Param param2) const {
+		const int column = static_cast<int>((unsigned(a) + unsigned(m) * unsigned(b)) * unsigned(param1) + unsigned(param2)) % c;
+		return column < 0 ? column + c : column;
+	}
+};
+
+// Both policies below hash the exact 64-bit key (a, b), no collision before hashing, no division, no sign fixup
+
+// Multiply-shift, the top bits of param1 * key + param2, numColumn must be a power of 2
+struct MultiplyShiftHash {
+	typedef uint64_t Param;
+	constexpr static uint32_t id = 2;
+	int shift = 32; // 32 - log2(numColumn)
+
+	explicit MultiplyShiftHash(int numColumn) {
+		assert(numColumn > 0 && (numColumn & (numColumn - 1)) == 0); // Power of 2
+		while (numColumn >>= 1)
+			shift--;
+	}
+
+	static Param Draw64(Random& random) {
+		Param a = 0;
+		for (int i = 0; i < 4; i++)
+			a = a << 16 | (random() & 0xFFFF);
+		return a;
+	}
+
+	static void Draw(Random& random, Param& param1, Param& param2) {
+		param1 = Draw64(random) | 1; // Odd multiplier
+		param2 = Draw64(random);
+	}
+
+	int operator()(int a, int b, Param param1, Param param2) const {
+		const uint64_t key = uint64_t(uint32_t(a)) << 32 | uint32_t(b);
+		return int((param1 * key + param2) >> 32 >> shift);
+	}
+};
+
+// Lemire's fast range, maps the top 32 bits of param1 * key + param2 to [0, numColumn) with a multiplication, any numColumn
+struct FastRangeHash {
+	typedef uint64_t Param;
+	constexpr static uint32_t id = 3; // Same parameters as MultiplyShiftHash, other columns
+	const uint64_t c;
+
+	explicit FastRangeHash(int numColumn): c(numColumn) { }
+
+	static void Draw(Random& random, Param& param1, Param& param2) {
+		MultiplyShiftHash::Draw(random, param1, param2);
+	}
+
+	int operator()(int a, int b, Param param1, Param param2) const {
+		const uint64_t key = uint64_t(uint32_t(a)) << 32 | uint32_t(b);
+		return int(((param1 * key + param2) >> 32) * c >> 32);
+	}
+};
+}
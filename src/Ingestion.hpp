@@ -0,0 +1,235 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SpscRing.hpp"
+
+namespace MIDAS {
+// Edges from several producer threads, scored by one scorer thread, no lock on the hot path
+// Each producer has its own SPSC ring, the scorer merges rings by timestamp, so the core sees a stream ordered by timestamp
+// A producer's timestamps should be non-decreasing, the scorer takes an edge of timestamp t only when every other producer has shown t or later,
+// either by an edge in its ring, by its last pushed edge, by Advance() or by Close(), so an idle producer should call Advance() or Close()
+// Core is any core with ScoreBatch(), it should only be used by the scorer thread until this object is destroyed
+// An idle scorer, or a producer waiting for space, yields numSpin times, then sleeps on a condition variable,
+// the other side only takes the lock to notify if it sees a sleeper, so the hot path stays lock-free
+template<class Core>
+struct Ingestion {
+	struct Edge {
+		int source, destination, timestamp;
+		int producer;
+	};
+
+	typedef std::function<void(const Edge* edge, const float* score, size_t n)> Callback; // Called on the scorer thread, in stream order
+
+	struct Producer { // Counters are only written by the producer thread
+		SpscRing<Edge> ring;
+		std::atomic<int> watermark; // Later edges have timestamps not smaller than this
+		std::atomic<bool> closed;
+		std::atomic<uint64_t> numPushed; // # edges accepted
+		std::atomic<uint64_t> numFull; // # pushes that found the ring full, i.e., backpressure
+		std::atomic<uint64_t> numDropped; // # edges dropped because the ring is full, only if dropWhenFull
+
+		explicit Producer(size_t lenRing): ring(lenRing), watermark(INT_MIN), closed(false), numPushed(0), numFull(0), numDropped(0) { }
+	};
+
+	Core& core;
+	const bool dropWhenFull; // If the ring is full, drop the edge, otherwise wait for the scorer
+	const Callback callback;
+	std::vector<std::unique_ptr<Producer>> producer;
+	constexpr static int lenBatch = 256; // # edges scored by one ScoreBatch()
+	Edge batch[lenBatch];
+	int sourceBatch[lenBatch], destinationBatch[lenBatch], timestampBatch[lenBatch];
+	float scoreBatch[lenBatch];
+	std::atomic<uint64_t> numScored;
+	constexpr static int numSpin = 1 << 8; // # yields before sleeping
+	constexpr static int timeSleep = 10; // Millisecond (ms), a sleeper also wakes up by itself, a safety net for notifications
+	std::mutex mutex; // Only for sleeping
+	std::condition_variable wakeScorer, wakeProducer;
+	std::atomic<bool> scorerAsleep;
+	std::atomic<int> numProducerAsleep;
+	std::thread scorer; // Last, so it starts after everything above
+
+	// lenRing: capacity of each ring, a power of 2
+	Ingestion(Core& core, int numProducer, size_t lenRing, Callback callback, bool dropWhenFull = false):
+		core(core),
+		dropWhenFull(dropWhenFull),
+		callback(callback),
+		numScored(0),
+		scorerAsleep(false),
+		numProducerAsleep(0) {
+		for (int p = 0; p < numProducer; p++)
+			producer.emplace_back(new Producer(lenRing));
+		scorer = std::thread(&Ingestion::Score, this);
+	}
+
+	Ingestion(const Ingestion& b) = delete;
+	Ingestion& operator=(const Ingestion& b) = delete;
+
+	// Remaining edges are still scored
+	~Ingestion() {
+		for (int p = 0; p < static_cast<int>(producer.size()); p++)
+			if (!producer[p]->closed.load(std::memory_order_relaxed))
+				Close(p);
+		scorer.join();
+	}
+
+	static void Increment(std::atomic<uint64_t>& a) { // Single writer, no need of a locked instruction
+		a.store(a.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// Called by producer p only, false if dropped
+	bool Push(int p, int source, int destination, int timestamp) {
+		Producer& a = *producer[p];
+		assert(timestamp >= a.watermark.load(std::memory_order_relaxed));
+		const Edge edge = {source, destination, timestamp, p};
+		if (!a.ring.TryPush(edge)) {
+			Increment(a.numFull);
+			if (dropWhenFull) {
+				Increment(a.numDropped);
+				return false;
+			}
+			for (int k = 0; !a.ring.TryPush(edge); k++) {
+				if (k < numSpin) {
+					std::this_thread::yield();
+					continue;
+				}
+				std::unique_lock<std::mutex> lock(mutex);
+				numProducerAsleep.fetch_add(1, std::memory_order_seq_cst); // Seen by the scorer after its pops, or TryPush() below sees them
+				if (!a.ring.TryPush(edge)) {
+					wakeProducer.wait_for(lock, std::chrono::milliseconds(int(timeSleep))); // A copy, so C++11 needs no definition
+					numProducerAsleep.fetch_sub(1, std::memory_order_relaxed);
+					continue;
+				}
+				numProducerAsleep.fetch_sub(1, std::memory_order_relaxed);
+				break;
+			}
+		}
+		Increment(a.numPushed);
+		a.watermark.store(timestamp, std::memory_order_release);
+		WakeScorer();
+		return true;
+	}
+
+	// After a change that may let the scorer proceed, only locks if it sleeps
+	void WakeScorer() {
+		std::atomic_thread_fence(std::memory_order_seq_cst); // The change is visible before the flag is read, pairs with Sleep()
+		if (scorerAsleep.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock(mutex);
+			wakeScorer.notify_one();
+		}
+	}
+
+	// Called by producer p only, promise no later edge is earlier than timestamp, so an idle producer does not hold the others back
+	void Advance(int p, int timestamp) {
+		assert(timestamp >= producer[p]->watermark.load(std::memory_order_relaxed));
+		producer[p]->watermark.store(timestamp, std::memory_order_release);
+		WakeScorer();
+	}
+
+	// Called by producer p only, no more edges from it
+	void Close(int p) {
+		producer[p]->closed.store(true, std::memory_order_release);
+		WakeScorer();
+	}
+
+	// The producer whose front edge is the next of the stream, -1 if there is none yet, done if all producers are closed and drained
+	int Next(bool& done) const {
+		int best = -1;
+		int timestampBest = INT_MAX;
+		int watermarkLeast = INT_MAX; // Of producers with empty rings
+		bool open = false;
+		for (int p = 0; p < static_cast<int>(producer.size()); p++) {
+			Producer& a = *producer[p];
+			const bool closed = a.closed.load(std::memory_order_acquire); // Before Front(), so closed and empty means drained
+			const int watermark = a.watermark.load(std::memory_order_acquire);
+			const Edge* const front = a.ring.Front();
+			if (front) {
+				if (front->timestamp < timestampBest) {
+					best = p;
+					timestampBest = front->timestamp;
+				}
+			} else if (!closed) {
+				open = true;
+				watermarkLeast = std::min(watermarkLeast, watermark);
+			}
+		}
+		done = best < 0 && !open;
+		return watermarkLeast < timestampBest ? -1 : best; // An empty producer may still push an earlier edge
+	}
+
+	// Scorer thread, when there is nothing to score, until a producer pushes, advances or closes
+	void Sleep() {
+		std::unique_lock<std::mutex> lock(mutex);
+		scorerAsleep.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst); // The flag is visible before rings are read again, pairs with WakeScorer()
+		bool done;
+		if (Next(done) < 0 && !done)
+			wakeScorer.wait_for(lock, std::chrono::milliseconds(int(timeSleep))); // A copy, so C++11 needs no definition
+		scorerAsleep.store(false, std::memory_order_relaxed);
+	}
+
+	// Scorer thread
+	void Score() {
+		int numIdle = 0;
+		while (true) {
+			int m = 0;
+			bool done = false;
+			while (m < lenBatch) {
+				const int best = Next(done);
+				if (best < 0) break;
+				batch[m++] = *producer[best]->ring.Front();
+				producer[best]->ring.Pop();
+			}
+			if (m) {
+				std::atomic_thread_fence(std::memory_order_seq_cst); // Pops are visible before the count is read, pairs with Push()
+				if (numProducerAsleep.load(std::memory_order_relaxed)) {
+					std::lock_guard<std::mutex> lock(mutex);
+					wakeProducer.notify_all();
+				}
+				for (int i = 0; i < m; i++) {
+					sourceBatch[i] = batch[i].source;
+					destinationBatch[i] = batch[i].destination;
+					timestampBatch[i] = batch[i].timestamp;
+				}
+				core.ScoreBatch(sourceBatch, destinationBatch, timestampBatch, scoreBatch, m);
+				callback(batch, scoreBatch, m);
+				numScored.store(numScored.load(std::memory_order_relaxed) + m, std::memory_order_release);
+				numIdle = 0;
+			} else if (done) {
+				return;
+			} else if (++numIdle < numSpin) {
+				std::this_thread::yield();
+			} else {
+				Sleep();
+			}
+		}
+	}
+};
+}
@@ -0,0 +1,392 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MIDAS_KERNEL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MIDAS_TARGET(isa) // MSVC emits any intrinsic without a flag
+#else
+#define MIDAS_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+// Whole-sketch sweeps with explicit SSE2/AVX2/AVX-512 implementations, picked at runtime by CPUID
+// Every implementation does the same float operations in the same order as the scalar one, no FMA, so results are identical bit by bit
+// Unaligned loads are used, they cost nothing on the 64-byte aligned storage from AlignedNew(), and slices of it still work
+
+namespace MIDAS {
+namespace Kernel {
+// Aligned storage
+// --------------------------------------------------------------------------------
+
+constexpr size_t alignment = 64; // A cache line, and an AVX-512 register
+
+template<class T>
+T* AlignedNew(size_t n) { // Only for trivial types, nothing is constructed, throws std::bad_alloc as new[] does
+	const size_t size = (n * sizeof(T) + alignment - 1) / alignment * alignment;
+#ifdef _MSC_VER
+	void* const p = _aligned_malloc(size ? size : alignment, alignment);
+	if (!p) throw std::bad_alloc();
+#else
+	void* p = nullptr;
+	if (posix_memalign(&p, alignment, size ? size : alignment)) throw std::bad_alloc();
+#endif
+	return static_cast<T*>(p);
+}
+
+inline void AlignedDelete(void* p) {
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+// Scalar
+// --------------------------------------------------------------------------------
+
+inline void FillScalar(float* data, size_t n, float with) {
+	for (size_t i = 0; i < n; i++)
+		data[i] = with;
+}
+
+inline void ScaleScalar(float* data, size_t n, float by) {
+	for (size_t i = 0; i < n; i++)
+		data[i] *= by;
+}
+
+// See FilteringCore::ConditionalMerge()
+inline void ConditionalMergeScalar(float* current, float* total, const float* score, size_t n, float threshold, float reciprocal, float factor) {
+	for (size_t i = 0; i < n; i++) {
+		const float shouldMerge = score[i] < threshold;
+		total[i] += shouldMerge * current[i] + (1 - shouldMerge) * total[i] * reciprocal;
+		current[i] *= factor;
+	}
+}
+
+// Same as ConditionalMergeScalar(), but threshold and factor of element i are threshold[i % period] and factor[i % period]
+// period is a multiple of lenPeriod, so every vector of every level sees a contiguous slice of them, j is where data[0] is in the period
+constexpr int lenPeriod = 16;
+
+inline void ConditionalMergePeriodicScalar(float* current, float* total, const float* score, size_t n, const float* threshold, const float* factor, int period, float reciprocal, int j) {
+	for (size_t i = 0; i < n; i++) {
+		const float shouldMerge = score[i] < threshold[j];
+		total[i] += shouldMerge * current[i] + (1 - shouldMerge) * total[i] * reciprocal;
+		current[i] *= factor[j];
+		if (++j == period) j = 0;
+	}
+}
+
+inline void ConditionalMergePeriodicScalar(float* current, float* total, const float* score, size_t n, const float* threshold, const float* factor, int period, float reciprocal) {
+	ConditionalMergePeriodicScalar(current, total, score, n, threshold, factor, period, reciprocal, 0);
+}
+
+// Same as ConditionalMergeScalar() on numBucket cell-interleaved buckets, a bucket is a cache line of
+// lenBucketLane currents, lenBucketLane totals, lenBucketLane scores and padding, see FusedCountMinSketch
+constexpr int lenBucket = alignment / sizeof(float);
+constexpr int lenBucketLane = 5;
+
+inline void ConditionalMergeBucketScalar(float* data, size_t numBucket, float threshold, float reciprocal, float factor) {
+	for (size_t i = 0; i < numBucket; i++, data += lenBucket)
+		ConditionalMergeScalar(data, data + lenBucketLane, data + 2 * lenBucketLane, lenBucketLane, threshold, reciprocal, factor);
+}
+
+#ifdef MIDAS_KERNEL_X86
+// SSE2
+// --------------------------------------------------------------------------------
+
+MIDAS_TARGET("sse2") inline void FillSSE2(float* data, size_t n, float with) {
+	const __m128 w = _mm_set1_ps(with);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(data + i, w);
+	FillScalar(data + i, n - i, with);
+}
+
+MIDAS_TARGET("sse2") inline void ScaleSSE2(float* data, size_t n, float by) {
+	const __m128 b = _mm_set1_ps(by);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), b));
+	ScaleScalar(data + i, n - i, by);
+}
+
+MIDAS_TARGET("sse2") inline void ConditionalMergeSSE2(float* current, float* total, const float* score, size_t n, float threshold, float reciprocal, float factor) {
+	const __m128 one = _mm_set1_ps(1), t = _mm_set1_ps(threshold), r = _mm_set1_ps(reciprocal), f = _mm_set1_ps(factor);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m128 c = _mm_loadu_ps(current + i);
+		const __m128 s = _mm_loadu_ps(total + i);
+		const __m128 m = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(score + i), t), one); // 1.f or 0.f
+		const __m128 merged = _mm_add_ps(_mm_mul_ps(m, c), _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(one, m), s), r));
+		_mm_storeu_ps(total + i, _mm_add_ps(s, merged));
+		_mm_storeu_ps(current + i, _mm_mul_ps(c, f));
+	}
+	ConditionalMergeScalar(current + i, total + i, score + i, n - i, threshold, reciprocal, factor);
+}
+
+MIDAS_TARGET("sse2") inline void ConditionalMergeBucketSSE2(float* data, size_t numBucket, float threshold, float reciprocal, float factor) {
+	const __m128 one = _mm_set1_ps(1), t = _mm_set1_ps(threshold), r = _mm_set1_ps(reciprocal), f = _mm_set1_ps(factor);
+	for (size_t i = 0; i < numBucket; i++, data += lenBucket) { // 4 lanes, then the last one
+		const __m128 c = _mm_load_ps(data);
+		const __m128 s = _mm_loadu_ps(data + lenBucketLane);
+		const __m128 m = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(data + 2 * lenBucketLane), t), one);
+		const __m128 merged = _mm_add_ps(_mm_mul_ps(m, c), _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(one, m), s), r));
+		_mm_storeu_ps(data + lenBucketLane, _mm_add_ps(s, merged));
+		_mm_store_ps(data, _mm_mul_ps(c, f));
+		ConditionalMergeScalar(data + 4, data + lenBucketLane + 4, data + 2 * lenBucketLane + 4, 1, threshold, reciprocal, factor);
+	}
+}
+
+MIDAS_TARGET("sse2") inline void ConditionalMergePeriodicSSE2(float* current, float* total, const float* score, size_t n, const float* threshold, const float* factor, int period, float reciprocal) {
+	const __m128 one = _mm_set1_ps(1), r = _mm_set1_ps(reciprocal);
+	size_t i = 0;
+	int j = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m128 c = _mm_loadu_ps(current + i);
+		const __m128 s = _mm_loadu_ps(total + i);
+		const __m128 m = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(score + i), _mm_loadu_ps(threshold + j)), one);
+		const __m128 merged = _mm_add_ps(_mm_mul_ps(m, c), _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(one, m), s), r));
+		_mm_storeu_ps(total + i, _mm_add_ps(s, merged));
+		_mm_storeu_ps(current + i, _mm_mul_ps(c, _mm_loadu_ps(factor + j)));
+		if ((j += 4) == period) j = 0;
+	}
+	ConditionalMergePeriodicScalar(current + i, total + i, score + i, n - i, threshold, factor, period, reciprocal, j);
+}
+
+// AVX2
+// --------------------------------------------------------------------------------
+
+MIDAS_TARGET("avx2") inline void FillAVX2(float* data, size_t n, float with) {
+	const __m256 w = _mm256_set1_ps(with);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(data + i, w);
+	FillScalar(data + i, n - i, with);
+}
+
+MIDAS_TARGET("avx2") inline void ScaleAVX2(float* data, size_t n, float by) {
+	const __m256 b = _mm256_set1_ps(by);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), b));
+	ScaleScalar(data + i, n - i, by);
+}
+
+MIDAS_TARGET("avx2") inline void ConditionalMergeAVX2(float* current, float* total, const float* score, size_t n, float threshold, float reciprocal, float factor) {
+	const __m256 one = _mm256_set1_ps(1), t = _mm256_set1_ps(threshold), r = _mm256_set1_ps(reciprocal), f = _mm256_set1_ps(factor);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256 c = _mm256_loadu_ps(current + i);
+		const __m256 s = _mm256_loadu_ps(total + i);
+		const __m256 m = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(score + i), t, _CMP_LT_OQ), one);
+		const __m256 merged = _mm256_add_ps(_mm256_mul_ps(m, c), _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(one, m), s), r));
+		_mm256_storeu_ps(total + i, _mm256_add_ps(s, merged));
+		_mm256_storeu_ps(current + i, _mm256_mul_ps(c, f));
+	}
+	ConditionalMergeScalar(current + i, total + i, score + i, n - i, threshold, reciprocal, factor);
+}
+
+MIDAS_TARGET("avx2") inline void ConditionalMergeBucketAVX2(float* data, size_t numBucket, float threshold, float reciprocal, float factor) {
+	const __m256 one = _mm256_set1_ps(1), t = _mm256_set1_ps(threshold), r = _mm256_set1_ps(reciprocal), f = _mm256_set1_ps(factor);
+	const __m256i mask = _mm256_setr_epi32(-1, -1, -1, -1, -1, 0, 0, 0); // lenBucketLane lanes
+	for (size_t i = 0; i < numBucket; i++, data += lenBucket) {
+		const __m256 c = _mm256_maskload_ps(data, mask);
+		const __m256 s = _mm256_maskload_ps(data + lenBucketLane, mask);
+		const __m256 m = _mm256_and_ps(_mm256_cmp_ps(_mm256_maskload_ps(data + 2 * lenBucketLane, mask), t, _CMP_LT_OQ), one);
+		const __m256 merged = _mm256_add_ps(_mm256_mul_ps(m, c), _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(one, m), s), r));
+		_mm256_maskstore_ps(data + lenBucketLane, mask, _mm256_add_ps(s, merged));
+		_mm256_maskstore_ps(data, mask, _mm256_mul_ps(c, f));
+	}
+}
+
+MIDAS_TARGET("avx2") inline void ConditionalMergePeriodicAVX2(float* current, float* total, const float* score, size_t n, const float* threshold, const float* factor, int period, float reciprocal) {
+	const __m256 one = _mm256_set1_ps(1), r = _mm256_set1_ps(reciprocal);
+	size_t i = 0;
+	int j = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256 c = _mm256_loadu_ps(current + i);
+		const __m256 s = _mm256_loadu_ps(total + i);
+		const __m256 m = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(score + i), _mm256_loadu_ps(threshold + j), _CMP_LT_OQ), one);
+		const __m256 merged = _mm256_add_ps(_mm256_mul_ps(m, c), _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(one, m), s), r));
+		_mm256_storeu_ps(total + i, _mm256_add_ps(s, merged));
+		_mm256_storeu_ps(current + i, _mm256_mul_ps(c, _mm256_loadu_ps(factor + j)));
+		if ((j += 8) == period) j = 0;
+	}
+	ConditionalMergePeriodicScalar(current + i, total + i, score + i, n - i, threshold, factor, period, reciprocal, j);
+}
+
+// AVX-512
+// --------------------------------------------------------------------------------
+
+MIDAS_TARGET("avx512f") inline void FillAVX512(float* data, size_t n, float with) {
+	const __m512 w = _mm512_set1_ps(with);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+		_mm512_storeu_ps(data + i, w);
+	FillScalar(data + i, n - i, with);
+}
+
+MIDAS_TARGET("avx512f") inline void ScaleAVX512(float* data, size_t n, float by) {
+	const __m512 b = _mm512_set1_ps(by);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+		_mm512_storeu_ps(data + i, _mm512_mul_ps(_mm512_loadu_ps(data + i), b));
+	ScaleScalar(data + i, n - i, by);
+}
+
+MIDAS_TARGET("avx512f") inline void ConditionalMergeAVX512(float* current, float* total, const float* score, size_t n, float threshold, float reciprocal, float factor) {
+	const __m512 one = _mm512_set1_ps(1), zero = _mm512_setzero_ps(), t = _mm512_set1_ps(threshold), r = _mm512_set1_ps(reciprocal), f = _mm512_set1_ps(factor);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		const __m512 c = _mm512_loadu_ps(current + i);
+		const __m512 s = _mm512_loadu_ps(total + i);
+		const __m512 m = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(_mm512_loadu_ps(score + i), t, _CMP_LT_OQ), zero, one);
+		const __m512 merged = _mm512_add_ps(_mm512_mul_ps(m, c), _mm512_mul_ps(_mm512_mul_ps(_mm512_sub_ps(one, m), s), r));
+		_mm512_storeu_ps(total + i, _mm512_add_ps(s, merged));
+		_mm512_storeu_ps(current + i, _mm512_mul_ps(c, f));
+	}
+	ConditionalMergeScalar(current + i, total + i, score + i, n - i, threshold, reciprocal, factor);
+}
+
+MIDAS_TARGET("avx512f") inline void ConditionalMergeBucketAVX512(float* data, size_t numBucket, float threshold, float reciprocal, float factor) {
+	// A bucket is one register, totals are merged in place, currents and scores are permuted onto their lanes, a blend puts the results together
+	const __m512 one = _mm512_set1_ps(1), zero = _mm512_setzero_ps(), t = _mm512_set1_ps(threshold), r = _mm512_set1_ps(reciprocal), f = _mm512_set1_ps(factor);
+	const __m512i toTotal = _mm512_setr_epi32(0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 0, 0, 0, 0, 0, 0); // Lane 5 + k gets current k
+	const __m512i fromScore = _mm512_setr_epi32(0, 0, 0, 0, 0, 10, 11, 12, 13, 14, 0, 0, 0, 0, 0, 0); // Lane 5 + k gets score k
+	const __mmask16 laneCurrent = (1 << lenBucketLane) - 1, laneTotal = laneCurrent << lenBucketLane;
+	for (size_t i = 0; i < numBucket; i++, data += lenBucket) {
+		const __m512 b = _mm512_load_ps(data);
+		const __m512 c = _mm512_permutexvar_ps(toTotal, b);
+		const __m512 m = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(_mm512_permutexvar_ps(fromScore, b), t, _CMP_LT_OQ), zero, one);
+		const __m512 merged = _mm512_add_ps(_mm512_mul_ps(m, c), _mm512_mul_ps(_mm512_mul_ps(_mm512_sub_ps(one, m), b), r));
+		const __m512 a = _mm512_mask_blend_ps(laneTotal, _mm512_mask_blend_ps(laneCurrent, b, _mm512_mul_ps(b, f)), _mm512_add_ps(b, merged));
+		_mm512_store_ps(data, a);
+	}
+}
+
+MIDAS_TARGET("avx512f") inline void ConditionalMergePeriodicAVX512(float* current, float* total, const float* score, size_t n, const float* threshold, const float* factor, int period, float reciprocal) {
+	const __m512 one = _mm512_set1_ps(1), zero = _mm512_setzero_ps(), r = _mm512_set1_ps(reciprocal);
+	size_t i = 0;
+	int j = 0;
+	for (; i + 16 <= n; i += 16) {
+		const __m512 c = _mm512_loadu_ps(current + i);
+		const __m512 s = _mm512_loadu_ps(total + i);
+		const __m512 m = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(_mm512_loadu_ps(score + i), _mm512_loadu_ps(threshold + j), _CMP_LT_OQ), zero, one);
+		const __m512 merged = _mm512_add_ps(_mm512_mul_ps(m, c), _mm512_mul_ps(_mm512_mul_ps(_mm512_sub_ps(one, m), s), r));
+		_mm512_storeu_ps(total + i, _mm512_add_ps(s, merged));
+		_mm512_storeu_ps(current + i, _mm512_mul_ps(c, _mm512_loadu_ps(factor + j)));
+		if ((j += 16) == period) j = 0;
+	}
+	ConditionalMergePeriodicScalar(current + i, total + i, score + i, n - i, threshold, factor, period, reciprocal, j);
+}
+#endif
+
+// Dispatch
+// --------------------------------------------------------------------------------
+
+enum Level {
+	Scalar,
+	SSE2,
+	AVX2,
+	AVX512,
+};
+
+struct Table {
+	Level level;
+	const char* name;
+	void (* Fill)(float* data, size_t n, float with);
+	void (* Scale)(float* data, size_t n, float by);
+	void (* ConditionalMerge)(float* current, float* total, const float* score, size_t n, float threshold, float reciprocal, float factor);
+	void (* ConditionalMergePeriodic)(float* current, float* total, const float* score, size_t n, const float* threshold, const float* factor, int period, float reciprocal);
+	void (* ConditionalMergeBucket)(float* data, size_t numBucket, float threshold, float reciprocal, float factor);
+};
+
+inline Level Detect() {
+#if defined(MIDAS_KERNEL_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	const int maxLeaf = info[0];
+	__cpuid(info, 1);
+	const bool sse2 = info[3] >> 26 & 1;
+	const bool osxsave = info[2] >> 27 & 1;
+	const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+	bool avx2 = false, avx512 = false;
+	if (maxLeaf >= 7) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] >> 5 & 1) && (xcr0 & 0x6) == 0x6; // YMM state enabled by OS
+		avx512 = (info[1] >> 16 & 1) && (xcr0 & 0xE6) == 0xE6; // ZMM and opmask state enabled by OS
+	}
+	return avx512 ? AVX512 : avx2 ? AVX2 : sse2 ? SSE2 : Scalar;
+#elif defined(MIDAS_KERNEL_X86)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f") ? AVX512 : __builtin_cpu_supports("avx2") ? AVX2 : __builtin_cpu_supports("sse2") ? SSE2 : Scalar;
+#else
+	return Scalar;
+#endif
+}
+
+// Implementations of a level, the level should not be higher than Detect()
+inline Table TableOf(Level level) {
+	switch (level) {
+#ifdef MIDAS_KERNEL_X86
+		case AVX512:
+			return {AVX512, "AVX-512", FillAVX512, ScaleAVX512, ConditionalMergeAVX512, ConditionalMergePeriodicAVX512, ConditionalMergeBucketAVX512};
+		case AVX2:
+			return {AVX2, "AVX2", FillAVX2, ScaleAVX2, ConditionalMergeAVX2, ConditionalMergePeriodicAVX2, ConditionalMergeBucketAVX2};
+		case SSE2:
+			return {SSE2, "SSE2", FillSSE2, ScaleSSE2, ConditionalMergeSSE2, ConditionalMergePeriodicSSE2, ConditionalMergeBucketSSE2};
+#endif
+		default:
+			return {Scalar, "Scalar", FillScalar, ScaleScalar, ConditionalMergeScalar, ConditionalMergePeriodicScalar, ConditionalMergeBucketScalar};
+	}
+}
+
+// The best implementations of this CPU, detected once
+inline const Table& Best() {
+	static const Table table = TableOf(Detect());
+	return table;
+}
+
+inline void Fill(float* data, size_t n, float with) {
+	Best().Fill(data, n, with);
+}
+
+inline void Scale(float* data, size_t n, float by) {
+	Best().Scale(data, n, by);
+}
+
+inline void ConditionalMerge(float* current, float* total, const float* score, size_t n, float threshold, float reciprocal, float factor) {
+	Best().ConditionalMerge(current, total, score, n, threshold, reciprocal, factor);
+}
+
+inline void ConditionalMergePeriodic(float* current, float* total, const float* score, size_t n, const float* threshold, const float* factor, int period, float reciprocal) {
+	Best().ConditionalMergePeriodic(current, total, score, n, threshold, factor, period, reciprocal);
+}
+
+inline void ConditionalMergeBucket(float* data, size_t numBucket, float threshold, float reciprocal, float factor) {
+	Best().ConditionalMergeBucket(data, numBucket, threshold, reciprocal, factor);
+}
+}
+}
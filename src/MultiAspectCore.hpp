@@ -0,0 +1,186 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "FilteringCore.hpp"
+
+namespace MIDAS {
+// Bucket of a non-negative numeric attribute, e.g., bytes, numPerDoubling buckets between consecutive powers of 2, 0 for 0
+inline int LogBucket(double value, int numPerDoubling = 4) {
+	return value <= 0 ? 0 : 1 + static_cast<int>(std::log2(1 + value) * numPerDoubling);
+}
+
+// MIDAS-F of records with numAttribute categorical attributes, e.g., source, destination, port, protocol, LogBucket(bytes)
+// An aspect is an attribute or a pair of them, each has current, total and score CMSs, the score of a record is the max over aspects
+// All CMSs are one arena, [current/total/score][aspect][cell], so a tick is one ConditionalMerge() over all aspects,
+// and a record is hashed once into absolute indices of the arena, so the cost of a record or a tick is linear in the # aspects
+// Aspects {0, 1}, {0}, {1} of (source, destination) give the same scores as FilteringCore under the same Random
+template<int R = 0, class Hasher = ModuloHash>
+struct BasicMultiAspectCore {
+	typedef typename Hasher::Param Param;
+
+	struct Aspect {
+		int attribute[2]; // attribute[1] < 0 if a single attribute
+	};
+
+	const int r, c;
+	const Hasher hasher;
+	const int numAttribute;
+	const std::vector<Aspect> aspect;
+	const int numAspect;
+	const float threshold;
+	const float factor;
+	int timestamp = 1;
+	float timestampReciprocal = 0;
+	const int lenData; // Of a CMS
+	const size_t lenKind; // numAspect * lenData rounded up to a cache line
+	float* const data; // [current/total/score][aspect][cell], 64-byte aligned
+	Param* const param; // [aspect][param1/param2][row]
+	constexpr static int lenBatch = 256; // # records hashed ahead by ScoreBatch()
+	constexpr static int distancePrefetch = 16; // # records prefetched ahead by ScoreBatch()
+	int* const index; // Of a record, [aspect][row], offsets into a kind of the arena
+	int* const indexBatch; // lenBatch records
+
+	BasicMultiAspectCore(int numRow, int numColumn, int numAttribute, const std::vector<Aspect>& aspect, float threshold, float factor = 0.5):
+		BasicMultiAspectCore(Random(), numRow, numColumn, numAttribute, aspect, threshold, factor) { }
+
+	// Hash parameters are drawn from random instead of the global rand(), e.g., Random(seed), aspect by aspect, row by row
+	BasicMultiAspectCore(Random random, int numRow, int numColumn, int numAttribute, const std::vector<Aspect>& aspect, float threshold, float factor = 0.5):
+		r(numRow),
+		c(numColumn),
+		hasher(numColumn),
+		numAttribute(numAttribute),
+		aspect(aspect),
+		numAspect(static_cast<int>(aspect.size())),
+		threshold(threshold),
+		factor(factor),
+		lenData(numRow * numColumn),
+		lenKind((size_t(numAspect) * lenData + Kernel::alignment / sizeof(float) - 1) / (Kernel::alignment / sizeof(float)) * (Kernel::alignment / sizeof(float))),
+		data(Kernel::AlignedNew<float>(3 * lenKind)),
+		param(new Param[2 * numAspect * numRow]),
+		index(new int[numAspect * numRow]),
+		indexBatch(new int[lenBatch * numAspect * numRow]) {
+		assert(R == 0 || R == numRow);
+		for (int k = 0; k < numAspect; k++) {
+			assert(aspect[k].attribute[0] >= 0 && aspect[k].attribute[0] < numAttribute && aspect[k].attribute[1] < numAttribute);
+			for (int i = 0; i < r; i++)
+				Hasher::Draw(random, param[2 * k * r + i], param[(2 * k + 1) * r + i]);
+		}
+		Kernel::Fill(data, 3 * lenKind, 0);
+	}
+
+	BasicMultiAspectCore(const BasicMultiAspectCore& b) = delete;
+	BasicMultiAspectCore& operator=(const BasicMultiAspectCore& b) = delete;
+
+	virtual ~BasicMultiAspectCore() {
+		Kernel::AlignedDelete(data);
+		delete[] param;
+		delete[] index;
+		delete[] indexBatch;
+	}
+
+	// Every attribute, then every pair of them, i < j
+	static std::vector<Aspect> AllPairs(int numAttribute) {
+		std::vector<Aspect> aspect = Singles(numAttribute);
+		for (int i = 0; i < numAttribute; i++)
+			for (int j = i + 1; j < numAttribute; j++)
+				aspect.push_back({{i, j}});
+		return aspect;
+	}
+
+	// Every attribute on its own
+	static std::vector<Aspect> Singles(int numAttribute) {
+		std::vector<Aspect> aspect;
+		for (int i = 0; i < numAttribute; i++)
+			aspect.push_back({{i, -1}});
+		return aspect;
+	}
+
+	int NumRow() const {
+		return R ? R : r;
+	}
+
+	// kind: 0 current, 1 total, 2 score
+	float* Data(int kind) const {
+		return data + kind * lenKind;
+	}
+
+	// All aspects of a record, indexOut[k * numRow + i] is row i of aspect k, an offset into Data(kind)
+	void Hash(int* indexOut, const int* attribute) const {
+		for (int k = 0; k < numAspect; k++) {
+			const int a = attribute[aspect[k].attribute[0]];
+			const int b = aspect[k].attribute[1] < 0 ? 0 : attribute[aspect[k].attribute[1]]; // Same as CountMinSketch::Hash(a)
+			const Param* const p = param + 2 * k * r;
+			for (int i = 0; i < NumRow(); i++)
+				indexOut[k * r + i] = k * lenData + i * c + hasher(a, b, p[i], p[r + i]);
+		}
+	}
+
+	void Prefetch(const int* index) const {
+		for (int j = 0; j < numAspect * NumRow(); j++) {
+			MIDAS_PREFETCH(Data(0) + index[j]);
+			MIDAS_PREFETCH(Data(1) + index[j]);
+		}
+	}
+
+	// FilteringCore::Score() with the dense merge, aspect by aspect, see FilteringCore::Update()
+	float Score(const int* index, int timestamp) {
+		float* const current = Data(0);
+		float* const total = Data(1);
+		float* const score = Data(2);
+		if (this->timestamp < timestamp) {
+			Kernel::ConditionalMerge(current, total, score, size_t(numAspect) * lenData, threshold, timestampReciprocal, factor);
+			timestampReciprocal = 1.f / (timestamp - 1);
+			this->timestamp = timestamp;
+		}
+		float scoreRecord = 0;
+		for (int k = 0; k < numAspect; k++) {
+			const float v = BasicFilteringCore<R, Hasher>::Update(current, total, score, index + k * r, r, timestamp);
+			scoreRecord = k ? std::max(scoreRecord, v) : v;
+		}
+		return scoreRecord;
+	}
+
+	// attribute has numAttribute ints
+	float operator()(const int* attribute, int timestamp) {
+		Hash(index, attribute);
+		return Score(index, timestamp);
+	}
+
+	// attribute has n records of numAttribute ints each, same scores as calling operator() on each record
+	void ScoreBatch(const int* attribute, const int* timestamp, float* scoreOut, size_t n) {
+		const int lenRecord = numAspect * r;
+		for (size_t i = 0; i < n; i += lenBatch) {
+			const int m = static_cast<int>(std::min<size_t>(lenBatch, n - i));
+			for (int j = 0; j < m; j++)
+				Hash(indexBatch + j * lenRecord, attribute + (i + j) * numAttribute);
+			for (int j = 0; j < m; j++) {
+				if (j + distancePrefetch < m)
+					Prefetch(indexBatch + (j + distancePrefetch) * lenRecord);
+				scoreOut[i + j] = Score(indexBatch + j * lenRecord, timestamp[i + j]);
+			}
+		}
+	}
+};
+
+typedef BasicMultiAspectCore<> MultiAspectCore;
+}
@@ -0,0 +1,194 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Front-end of node keys that are not small ints, e.g., 64-bit device ids, IPv6 addresses or user names
+// Keys become the int ids cores take, so CSVs no longer need the category encoding of PreprocessData.py before streaming
+// - KeyHash: a 31-bit fingerprint, two keys share an id with probability 2^-31, far below a collision of CMS cells
+// - KeyDictionary: exact ids from 0 in order of appearance for the first capacity keys, fingerprints beyond, bounded memory
+
+namespace MIDAS {
+// wyhash-style mixing, the 128-bit product of a and b, folded to 64 bits
+inline uint64_t KeyMix(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+	const __uint128_t p = static_cast<__uint128_t>(a) * b;
+	return static_cast<uint64_t>(p) ^ static_cast<uint64_t>(p >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	uint64_t high;
+	const uint64_t low = _umul128(a, b, &high);
+	return low ^ high;
+#else
+	const uint64_t aLow = uint32_t(a), aHigh = a >> 32, bLow = uint32_t(b), bHigh = b >> 32;
+	const uint64_t ll = aLow * bLow, lh = aLow * bHigh, hl = aHigh * bLow, hh = aHigh * bHigh;
+	const uint64_t middle = (ll >> 32) + uint32_t(lh) + uint32_t(hl);
+	return ((middle << 32) | uint32_t(ll)) ^ (hh + (lh >> 32) + (hl >> 32) + (middle >> 32));
+#endif
+}
+
+constexpr uint64_t keySecret[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+inline uint64_t KeyRead8(const unsigned char* p) {
+	uint64_t a;
+	std::memcpy(&a, p, 8); // Little-endian, as everything else here
+	return a;
+}
+
+inline uint64_t KeyRead4(const unsigned char* p) {
+	uint32_t a;
+	std::memcpy(&a, p, 4);
+	return a;
+}
+
+// 64-bit hash of a 64-bit key
+inline uint64_t HashKey(uint64_t key, uint64_t seed = 0) {
+	return KeyMix(keySecret[1] ^ 8, KeyMix(key ^ keySecret[1], seed ^ keySecret[0]));
+}
+
+// 64-bit hash of len bytes, 16 bytes per step, short keys are read as two overlapping words, no loop
+inline uint64_t HashKey(const void* key, size_t len, uint64_t seed = 0) {
+	const unsigned char* p = static_cast<const unsigned char*>(key);
+	seed ^= KeyMix(seed ^ keySecret[0], keySecret[1]);
+	uint64_t a, b;
+	if (len <= 16) {
+		if (len >= 4) {
+			a = KeyRead4(p) << 32 | KeyRead4(p + ((len >> 3) << 2));
+			b = KeyRead4(p + len - 4) << 32 | KeyRead4(p + len - 4 - ((len >> 3) << 2));
+		} else if (len) {
+			a = uint64_t(p[0]) << 16 | uint64_t(p[len >> 1]) << 8 | p[len - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = len;
+		for (; i > 16; i -= 16, p += 16)
+			seed = KeyMix(KeyRead8(p) ^ keySecret[1], KeyRead8(p + 8) ^ seed);
+		a = KeyRead8(p + i - 16);
+		b = KeyRead8(p + i - 8);
+	}
+	return KeyMix(keySecret[1] ^ len, KeyMix(a ^ keySecret[1], b ^ seed));
+}
+
+// Keys to 31-bit fingerprints, non-negative ints, stateless, so any thread or process gives the same id to the same key
+struct KeyHash {
+	const uint64_t seed;
+
+	explicit KeyHash(uint64_t seed = 0): seed(seed) { }
+
+	int operator()(uint64_t key) const {
+		return static_cast<int>(HashKey(key, seed) >> 33);
+	}
+
+	int operator()(const void* key, size_t len) const {
+		return static_cast<int>(HashKey(key, len, seed) >> 33);
+	}
+
+	int operator()(const std::string& key) const {
+		return (*this)(key.data(), key.size());
+	}
+};
+
+// Keys to ids from 0 in order of appearance, like the category codes of PreprocessData.py but without a pass over the data
+// Only the 64-bit hash of a key is kept, so a table slot is 12 bytes for keys of any length
+// After capacity keys, new keys get fingerprints in [capacity, INT_MAX) and the table stays as it is
+struct KeyDictionary {
+	const uint64_t seed;
+	const int capacity;
+	const uint64_t mask; // # slots - 1, a power of 2 of at least 2 * capacity, so probes stay short
+	uint64_t* const slot; // 64-bit hashes of keys, 0 is empty
+	int* const id;
+	int numKey = 0;
+	uint64_t numOverflow = 0; // # lookups of keys beyond capacity
+
+	static uint64_t LenTable(int capacity) {
+		uint64_t a = 2;
+		while (a < 2ull * capacity)
+			a <<= 1;
+		return a;
+	}
+
+	explicit KeyDictionary(int capacity, uint64_t seed = 0):
+		seed(seed),
+		capacity(capacity),
+		mask(LenTable(capacity) - 1),
+		slot(new uint64_t[mask + 1]),
+		id(new int[mask + 1]) {
+		std::fill(slot, slot + mask + 1, 0);
+	}
+
+	KeyDictionary(const KeyDictionary& b) = delete;
+	KeyDictionary& operator=(const KeyDictionary& b) = delete;
+
+	~KeyDictionary() {
+		delete[] slot;
+		delete[] id;
+	}
+
+	// Id of a key by its 64-bit hash, see HashKey()
+	int operator[](uint64_t hash) {
+		hash += !hash; // 0 marks an empty slot
+		for (uint64_t i = hash & mask;; i = (i + 1) & mask) { // Linear probing
+			if (slot[i] == hash) return id[i];
+			if (!slot[i]) {
+				if (numKey == capacity) {
+					numOverflow++;
+					return capacity + static_cast<int>((hash >> 1) % (uint64_t(INT_MAX) - capacity));
+				}
+				slot[i] = hash;
+				return id[i] = numKey++;
+			}
+		}
+	}
+
+	int operator()(uint64_t key) {
+		return (*this)[HashKey(key, seed)];
+	}
+
+	int operator()(const void* key, size_t len) {
+		return (*this)[HashKey(key, len, seed)];
+	}
+
+	int operator()(const std::string& key) {
+		return (*this)(key.data(), key.size());
+	}
+};
+
+// Same scores as core.ScoreBatch() on the ids of the keys, map is a KeyHash or a KeyDictionary, ids are mapped a block at a time
+template<class Core, class Map>
+void ScoreKeyBatch(Core& core, Map& map, const uint64_t* source, const uint64_t* destination, const int* timestamp, float* scoreOut, size_t n) {
+	constexpr size_t lenBlock = 1024;
+	int sourceId[lenBlock], destinationId[lenBlock];
+	for (size_t i = 0; i < n; i += lenBlock) {
+		const size_t m = std::min(lenBlock, n - i);
+		for (size_t j = 0; j < m; j++) {
+			sourceId[j] = map(source[i + j]);
+			destinationId[j] = map(destination[i + j]);
+		}
+		core.ScoreBatch(sourceId, destinationId, timestamp + i, scoreOut + i, m);
+	}
+}
+}
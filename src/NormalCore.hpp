@@ -17,37 +17,170 @@
 #pragma once
 
 #include <cmath>
+#include <vector>
 
-#include "CountMinSketch.hpp"
+#include "Delta.hpp"
+#include "Snapshot.hpp"
 
 namespace MIDAS {
-struct NormalCore {
+template<int R = 0, class Hasher = ModuloHash, class Storage = FloatStorage>
+struct BasicNormalCore {
 	int timestamp = 1;
-	int* const index; // Pre-compute the index to-be-modified, thanks to the same structure of CMSs
-	CountMinSketch numCurrent, numTotal;
+	IndexArray<R> index; // Pre-compute the index to-be-modified, thanks to the same structure of CMSs
+	BasicCountMinSketch<R, Hasher, Storage> numCurrent, numTotal;
+	constexpr static int ratioTouched = 16; // Beyond 1 / ratioTouched of the cells, a tick clears numCurrent densely, a scattered store costs about a cache line
+	std::vector<int> touched; // Cells of numCurrent that became nonzero in this tick, only these are cleared by the next tick
+	int numTouched = 0; // More than touched.size() means too many, or unknown, so the next tick clears densely
+	int numEdge = 0; // Scored in this tick, a tick after a busy one clears densely without tracking
+	constexpr static int lenBatch = 256; // # edges hashed ahead by ScoreBatch()
+	constexpr static int distancePrefetch = 16; // # edges prefetched ahead by ScoreBatch()
+	IndexArray<lenBatch * R> indexBatch;
+	DeltaLog* deltaLog = nullptr; // Set by a DeltaWriter, cells are recorded before they change
 
-	NormalCore(int numRow, int numColumn):
-		index(new int[numRow]),
-		numCurrent(numRow, numColumn),
-		numTotal(numCurrent) { }
+	BasicNormalCore(int numRow, int numColumn): BasicNormalCore(Random(), numRow, numColumn) { }
 
-	virtual ~NormalCore() {
-		delete[] index;
+	// Hash parameters are drawn from random instead of the global rand(), e.g., Random(seed)
+	BasicNormalCore(Random random, int numRow, int numColumn):
+		index(numRow),
+		numCurrent(numRow, numColumn, random),
+		numTotal(numCurrent),
+		touched(numRow * numColumn / ratioTouched),
+		indexBatch(lenBatch * numRow) { }
+
+	// Restore from a snapshot, cells are used in place, so the snapshot should outlive the core, check Fits() first
+	explicit BasicNormalCore(const Snapshot& snapshot):
+		timestamp(snapshot.header->timestamp),
+		index(snapshot.header->numRow),
+		numCurrent(snapshot.View(0)),
+		numTotal(snapshot.View(1)),
+		touched(numCurrent.lenData / ratioTouched),
+		numTouched(numCurrent.lenData), // Cells of the snapshot are not tracked
+		indexBatch(lenBatch * snapshot.header->numRow) { }
+
+	virtual ~BasicNormalCore() { }
+
+	static bool Fits(const Snapshot& snapshot) {
+		const uint32_t storage[] = {Storage::id, Storage::id};
+		const uint32_t sizeCell[] = {sizeof(typename Storage::Cell), sizeof(typename Storage::Cell)};
+		return snapshot.Fits(SnapshotNormal, 2, Hasher::id, sizeof(typename Hasher::Param), storage, sizeCell) && (R == 0 || R == snapshot.header->numRow);
+	}
+
+	// Hash parameters, timestamp and cells, see SaveSnapshot() and SaveInBackground()
+	void Plan(SnapshotPlan& plan) const {
+		plan.Begin(SnapshotNormal, numCurrent.NumRow(), numCurrent.c, timestamp);
+		plan.Add(numCurrent);
+		plan.Add(numTotal);
 	}
 
 	static float ComputeScore(float a, float s, float t) {
 		return s == 0 || t - 1 == 0 ? 0 : pow((a - s / t) * t, 2) / (s * (t - 1));
 	}
 
-	float operator()(int source, int destination, int timestamp) {
+	// Move to a later timestamp without an edge, e.g., a node of a distributed stream whose slice is empty at this timestamp
+	void Advance(int timestamp) {
 		if (this->timestamp < timestamp) {
-			numCurrent.ClearAll();
+			if (numTouched > static_cast<int>(touched.size())) {
+				if (deltaLog) deltaLog->BeforeAll(0, numCurrent);
+				numCurrent.ClearAll();
+			} else
+				for (int i = 0; i < numTouched; i++) {
+					if (deltaLog) deltaLog->Record(0, touched[i], Storage::Load(numCurrent.data[touched[i]]));
+					numCurrent.data[touched[i]] = Storage::Store(0);
+				}
+			numTouched = numEdge * numCurrent.NumRow() <= static_cast<int>(touched.size()) ? 0 : numCurrent.lenData; // Each edge touches at most numRow cells
+			numEdge = 0;
 			this->timestamp = timestamp;
 		}
+	}
+
+	// Record cells of index that are still 0 in this tick, before they are added to, counts only grow within a tick, so none is recorded twice
+	void Touch(const int* index) {
+		if (numTouched > static_cast<int>(touched.size())) return;
+		for (int i = 0; i < numCurrent.NumRow(); i++)
+			if (Storage::Load(numCurrent.data[index[i]]) == 0) {
+				if (numTouched == static_cast<int>(touched.size())) {
+					numTouched++; // Dense from now on
+					return;
+				}
+				touched[numTouched++] = index[i];
+			}
+	}
+
+	// b is another core on a disjoint slice of the same stream, with the same hash parameters
+	// Totals are summed, current counts are summed if both are at the same timestamp, otherwise only the later ones are kept
+	void Merge(const BasicNormalCore& b) {
+		Advance(b.timestamp);
+		if (deltaLog) {
+			deltaLog->BeforeAll(0, numCurrent);
+			deltaLog->BeforeAll(1, numTotal);
+		}
+		if (timestamp == b.timestamp) {
+			numCurrent.Merge(b.numCurrent);
+			numTouched = numCurrent.lenData; // Cells of b are not tracked
+		}
+		numTotal.Merge(b.numTotal);
+	}
+
+	// Score of an edge from the counts so far, without adding it
+	float Query(int source, int destination) {
 		numCurrent.Hash(index, source, destination);
+		return ComputeScore(numCurrent(index), numTotal(index), timestamp);
+	}
+
+	// Visit the CMSs in the order of snapshots, f(numCurrent), then f(numTotal)
+	template<class F>
+	void ForEachSketch(F& f) const {
+		f(numCurrent);
+		f(numTotal);
+	}
+
+	// Same, but f may write cells, so the next tick clears densely
+	template<class F>
+	void ForEachSketch(F& f) {
+		numTouched = numCurrent.lenData;
+		if (deltaLog) {
+			deltaLog->BeforeAll(0, numCurrent);
+			deltaLog->BeforeAll(1, numTotal);
+		}
+		f(numCurrent);
+		f(numTotal);
+	}
+
+	float Score(const int* index, int timestamp) {
+		Advance(timestamp);
+		numEdge++;
+		Touch(index);
+		if (deltaLog) {
+			deltaLog->Before(0, numCurrent, index);
+			deltaLog->Before(1, numTotal, index);
+		}
 		numCurrent.Add(index);
 		numTotal.Add(index);
 		return ComputeScore(numCurrent(index), numTotal(index), timestamp);
 	}
+
+	float operator()(int source, int destination, int timestamp) {
+		numCurrent.Hash(index, source, destination);
+		return Score(index, timestamp);
+	}
+
+	// Same scores as calling operator() on each edge, but hashing is done ahead so cells can be prefetched
+	void ScoreBatch(const int* source, const int* destination, const int* timestamp, float* scoreOut, size_t n) {
+		const int r = numCurrent.NumRow();
+		for (size_t i = 0; i < n; i += lenBatch) {
+			const int m = static_cast<int>(std::min<size_t>(lenBatch, n - i));
+			for (int j = 0; j < m; j++)
+				numCurrent.Hash(indexBatch + j * r, source[i + j], destination[i + j]);
+			for (int j = 0; j < m; j++) {
+				if (j + distancePrefetch < m) {
+					numCurrent.Prefetch(indexBatch + (j + distancePrefetch) * r);
+					numTotal.Prefetch(indexBatch + (j + distancePrefetch) * r);
+				}
+				scoreOut[i + j] = Score(indexBatch + j * r, timestamp[i + j]);
+			}
+		}
+	}
 };
+
+typedef BasicNormalCore<> NormalCore;
 }
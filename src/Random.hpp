@@ -0,0 +1,52 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace MIDAS {
+// Source of hash parameters, passed to constructors of CMSs and cores
+// Default: the global rand(), so srand() still reproduces old results, but it is shared by all threads
+// Seeded: a splitmix64 stream of its own, the same seed gives the same parameters on any thread, without a lock
+struct Random {
+	bool seeded;
+	uint64_t state;
+
+	Random(): seeded(false), state(0) { }
+
+	explicit Random(uint64_t seed): seeded(true), state(seed) { }
+
+	// The default one, it has no state of its own, so sharing it is fine
+	static Random& Global() {
+		static Random random;
+		return random;
+	}
+
+	uint64_t Next64() {
+		uint64_t z = state += 0x9E3779B97F4A7C15ull;
+		z = (z ^ z >> 30) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ z >> 27) * 0x94D049BB133111EBull;
+		return z ^ z >> 31;
+	}
+
+	// Same range as rand() with glibc, [0, 2^31)
+	int operator()() {
+		return seeded ? static_cast<int>(Next64() >> 33) : rand();
+	}
+};
+}
@@ -18,55 +18,178 @@
 
 #include <cmath>
 
-#include "CountMinSketch.hpp"
+#include "DecayingCountMinSketch.hpp"
+#include "Delta.hpp"
+#include "Snapshot.hpp"
 
 namespace MIDAS {
-struct RelationalCore {
+template<int R = 0, class Hasher = ModuloHash, class Storage = FloatStorage>
+struct BasicRelationalCore {
 	int timestamp = 1;
 	const float factor;
-	int* const indexEdge; // Pre-compute the index to-be-modified, thanks to the same structure of CMSs
-	int* const indexSource;
-	int* const indexDestination;
-	CountMinSketch numCurrentEdge, numTotalEdge;
-	CountMinSketch numCurrentSource, numTotalSource;
-	CountMinSketch numCurrentDestination, numTotalDestination;
-
-	RelationalCore(int numRow, int numColumn, float factor = 0.5):
+	bool decayGap = false; // If true, a jump of g timestamps decays current counts by factor^g instead of factor, i.e., empty ticks count
+	IndexArray<R> indexEdge; // Pre-compute the index to-be-modified, thanks to the same structure of CMSs
+	IndexArray<R> indexSource;
+	IndexArray<R> indexDestination;
+	BasicDecayingCountMinSketch<R, Hasher, Storage> numCurrentEdge;
+	BasicCountMinSketch<R, Hasher, Storage> numTotalEdge;
+	BasicDecayingCountMinSketch<R, Hasher, Storage> numCurrentSource;
+	BasicCountMinSketch<R, Hasher, Storage> numTotalSource;
+	BasicDecayingCountMinSketch<R, Hasher, Storage> numCurrentDestination;
+	BasicCountMinSketch<R, Hasher, Storage> numTotalDestination;
+	constexpr static int lenBatch = 256; // # edges hashed ahead by ScoreBatch()
+	constexpr static int distancePrefetch = 16; // # edges prefetched ahead by ScoreBatch()
+	IndexArray<3 * lenBatch * R> indexBatch; // Edge, source, destination, each has lenBatch * numRow
+	DeltaLog* deltaLog = nullptr; // Set by a DeltaWriter, cells are recorded before they change, k is the order of ForEachSketch()
+
+	// If lazy, a tick costs O(1) instead of O(numRow * numColumn), and scores differ from the eager ones by rounding errors only
+	BasicRelationalCore(int numRow, int numColumn, float factor = 0.5, bool lazy = false): BasicRelationalCore(Random(), numRow, numColumn, factor, lazy) { }
+
+	// Hash parameters are drawn from random instead of the global rand(), e.g., Random(seed)
+	BasicRelationalCore(Random random, int numRow, int numColumn, float factor = 0.5, bool lazy = false):
 		factor(factor),
-		indexEdge(new int[numRow]),
-		indexSource(new int[numRow]),
-		indexDestination(new int[numRow]),
-		numCurrentEdge(numRow, numColumn),
+		indexEdge(numRow),
+		indexSource(numRow),
+		indexDestination(numRow),
+		numCurrentEdge(numRow, numColumn, factor, lazy, random),
 		numTotalEdge(numCurrentEdge),
-		numCurrentSource(numRow, numColumn),
+		numCurrentSource(numRow, numColumn, factor, lazy, random),
 		numTotalSource(numCurrentSource),
-		numCurrentDestination(numRow, numColumn),
-		numTotalDestination(numCurrentDestination) { }
+		numCurrentDestination(numRow, numColumn, factor, lazy, random),
+		numTotalDestination(numCurrentDestination),
+		indexBatch(3 * lenBatch * numRow) { }
+
+	// Restore from a snapshot, cells are used in place, so the snapshot should outlive the core, check Fits() first
+	explicit BasicRelationalCore(const Snapshot& snapshot, bool lazy = false):
+		timestamp(snapshot.header->timestamp),
+		factor(snapshot.header->factor),
+		indexEdge(snapshot.header->numRow),
+		indexSource(snapshot.header->numRow),
+		indexDestination(snapshot.header->numRow),
+		numCurrentEdge(snapshot.View(0), factor, lazy),
+		numTotalEdge(snapshot.View(1)),
+		numCurrentSource(snapshot.View(2), factor, lazy),
+		numTotalSource(snapshot.View(3)),
+		numCurrentDestination(snapshot.View(4), factor, lazy),
+		numTotalDestination(snapshot.View(5)),
+		indexBatch(3 * lenBatch * snapshot.header->numRow) { }
+
+	virtual ~BasicRelationalCore() { }
+
+	static bool Fits(const Snapshot& snapshot) {
+		const uint32_t i = Storage::id, c = sizeof(typename Storage::Cell);
+		const uint32_t storage[] = {i, i, i, i, i, i};
+		const uint32_t sizeCell[] = {c, c, c, c, c, c};
+		return snapshot.Fits(SnapshotRelational, 6, Hasher::id, sizeof(typename Hasher::Param), storage, sizeCell) && (R == 0 || R == snapshot.header->numRow);
+	}
 
-	virtual ~RelationalCore() {
-		delete[] indexEdge;
-		delete[] indexSource;
-		delete[] indexDestination;
+	// Hash parameters, timestamp, factor and cells, lazy decays are flushed first, see SaveSnapshot() and SaveInBackground()
+	void Plan(SnapshotPlan& plan) const {
+		numCurrentEdge.Flush();
+		numCurrentSource.Flush();
+		numCurrentDestination.Flush();
+		plan.Begin(SnapshotRelational, numCurrentEdge.NumRow(), numCurrentEdge.c, timestamp, 0, 0, factor);
+		plan.Add(numCurrentEdge);
+		plan.Add(numTotalEdge);
+		plan.Add(numCurrentSource);
+		plan.Add(numTotalSource);
+		plan.Add(numCurrentDestination);
+		plan.Add(numTotalDestination);
 	}
 
 	static float ComputeScore(float a, float s, float t) {
 		return s == 0 || t - 1 == 0 ? 0 : pow((a - s / t) * t, 2) / (s * (t - 1));
 	}
 
-	float operator()(int source, int destination, int timestamp) {
+	// Move to a later timestamp without an edge, e.g., a node of a distributed stream whose slice is empty at this timestamp
+	void Advance(int timestamp) {
 		if (this->timestamp < timestamp) {
-			numCurrentEdge.MultiplyAll(factor);
-			numCurrentSource.MultiplyAll(factor);
-			numCurrentDestination.MultiplyAll(factor);
+			const int gap = decayGap ? timestamp - this->timestamp : 1;
+			if (deltaLog) { // Until the next decay, a cell that was not recorded still holds its value as of the previous message
+				deltaLog->BeforeAll(0, numCurrentEdge);
+				deltaLog->BeforeAll(2, numCurrentSource);
+				deltaLog->BeforeAll(4, numCurrentDestination);
+			}
+			numCurrentEdge.Decay(gap);
+			numCurrentSource.Decay(gap);
+			numCurrentDestination.Decay(gap);
 			this->timestamp = timestamp;
 		}
+	}
+
+	// Every cell may change, e.g., by a merge, so all are recorded in deltaLog if any
+	void RecordAll() {
+		if (deltaLog) {
+			deltaLog->BeforeAll(0, numCurrentEdge);
+			deltaLog->BeforeAll(1, numTotalEdge);
+			deltaLog->BeforeAll(2, numCurrentSource);
+			deltaLog->BeforeAll(3, numTotalSource);
+			deltaLog->BeforeAll(4, numCurrentDestination);
+			deltaLog->BeforeAll(5, numTotalDestination);
+		}
+	}
+
+	// b is another core on a disjoint slice of the same stream, with the same hash parameters and factor
+	// Totals are summed, current counts are summed after the earlier ones are decayed as their next tick would do
+	void Merge(const BasicRelationalCore& b) {
+		const float by = timestamp <= b.timestamp ? 1 : decayGap ? std::pow(factor, static_cast<float>(timestamp - b.timestamp)) : factor;
+		Advance(b.timestamp);
+		RecordAll();
+		numCurrentEdge.Merge(b.numCurrentEdge, by);
+		numTotalEdge.Merge(b.numTotalEdge);
+		numCurrentSource.Merge(b.numCurrentSource, by);
+		numTotalSource.Merge(b.numTotalSource);
+		numCurrentDestination.Merge(b.numCurrentDestination, by);
+		numTotalDestination.Merge(b.numTotalDestination);
+	}
+
+	// Score of an edge from the counts so far, without adding it
+	float Query(int source, int destination) {
 		numCurrentEdge.Hash(indexEdge, source, destination);
+		numCurrentSource.Hash(indexSource, source);
+		numCurrentDestination.Hash(indexDestination, destination);
+		return std::max({
+			ComputeScore(numCurrentEdge(indexEdge), numTotalEdge(indexEdge), timestamp),
+			ComputeScore(numCurrentSource(indexSource), numTotalSource(indexSource), timestamp),
+			ComputeScore(numCurrentDestination(indexDestination), numTotalDestination(indexDestination), timestamp),
+		});
+	}
+
+	// Visit the CMSs in the order of snapshots, lazy decays are flushed first
+	template<class F>
+	void ForEachSketch(F& f) const {
+		numCurrentEdge.Flush();
+		numCurrentSource.Flush();
+		numCurrentDestination.Flush();
+		f(static_cast<const BasicCountMinSketch<R, Hasher, Storage>&>(numCurrentEdge));
+		f(numTotalEdge);
+		f(static_cast<const BasicCountMinSketch<R, Hasher, Storage>&>(numCurrentSource));
+		f(numTotalSource);
+		f(static_cast<const BasicCountMinSketch<R, Hasher, Storage>&>(numCurrentDestination));
+		f(numTotalDestination);
+	}
+
+	// Same, but f may write cells
+	template<class F>
+	void ForEachSketch(F& f) {
+		RecordAll();
+		static_cast<const BasicRelationalCore&>(*this).ForEachSketch(f);
+	}
+
+	float Score(const int* indexEdge, const int* indexSource, const int* indexDestination, int timestamp) {
+		Advance(timestamp);
+		if (deltaLog) {
+			deltaLog->Before(0, numCurrentEdge, indexEdge);
+			deltaLog->Before(1, numTotalEdge, indexEdge);
+			deltaLog->Before(2, numCurrentSource, indexSource);
+			deltaLog->Before(3, numTotalSource, indexSource);
+			deltaLog->Before(4, numCurrentDestination, indexDestination);
+			deltaLog->Before(5, numTotalDestination, indexDestination);
+		}
 		numCurrentEdge.Add(indexEdge);
 		numTotalEdge.Add(indexEdge);
-		numCurrentSource.Hash(indexSource, source);
 		numCurrentSource.Add(indexSource);
 		numTotalSource.Add(indexSource);
-		numCurrentDestination.Hash(indexDestination, destination);
 		numCurrentDestination.Add(indexDestination);
 		numTotalDestination.Add(indexDestination);
 		return std::max({
@@ -75,5 +198,42 @@ struct RelationalCore {
 			ComputeScore(numCurrentDestination(indexDestination), numTotalDestination(indexDestination), timestamp),
 		});
 	}
+
+	float operator()(int source, int destination, int timestamp) {
+		numCurrentEdge.Hash(indexEdge, source, destination);
+		numCurrentSource.Hash(indexSource, source);
+		numCurrentDestination.Hash(indexDestination, destination);
+		return Score(indexEdge, indexSource, indexDestination, timestamp);
+	}
+
+	// Same scores as calling operator() on each edge, but hashing is done ahead so cells can be prefetched
+	void ScoreBatch(const int* source, const int* destination, const int* timestamp, float* scoreOut, size_t n) {
+		const int r = numCurrentEdge.NumRow();
+		int* const indexEdge = indexBatch;
+		int* const indexSource = indexBatch + lenBatch * r;
+		int* const indexDestination = indexBatch + 2 * lenBatch * r;
+		for (size_t i = 0; i < n; i += lenBatch) {
+			const int m = static_cast<int>(std::min<size_t>(lenBatch, n - i));
+			for (int j = 0; j < m; j++) {
+				numCurrentEdge.Hash(indexEdge + j * r, source[i + j], destination[i + j]);
+				numCurrentSource.Hash(indexSource + j * r, source[i + j]);
+				numCurrentDestination.Hash(indexDestination + j * r, destination[i + j]);
+			}
+			for (int j = 0; j < m; j++) {
+				if (j + distancePrefetch < m) {
+					const int k = (j + distancePrefetch) * r;
+					numCurrentEdge.Prefetch(indexEdge + k);
+					numTotalEdge.Prefetch(indexEdge + k);
+					numCurrentSource.Prefetch(indexSource + k);
+					numTotalSource.Prefetch(indexSource + k);
+					numCurrentDestination.Prefetch(indexDestination + k);
+					numTotalDestination.Prefetch(indexDestination + k);
+				}
+				scoreOut[i + j] = Score(indexEdge + j * r, indexSource + j * r, indexDestination + j * r, timestamp[i + j]);
+			}
+		}
+	}
 };
+
+typedef BasicRelationalCore<> RelationalCore;
 }
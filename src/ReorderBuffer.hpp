@@ -0,0 +1,126 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace MIDAS {
+// Edges of slightly out-of-order timestamps, sorted into one bucket per tick, a bucket is scored once no edge of it can arrive
+// Tick t is scored when an edge later than t + lateness arrives, or by Flush(), edges of a tick keep their arrival order
+// An edge of a tick already scored is late, it is dropped and counted, scoring it against a later tick would be wrong
+// A gap of many ticks costs no more than lateness + 1 buckets here, see RelationalCore::decayGap for the decay across it
+// Core is any core with ScoreBatch(), only lateness + 1 ticks are held, buckets keep their capacity, so a steady stream allocates nothing
+template<class Core>
+struct ReorderBuffer {
+	typedef std::function<void(const int* source, const int* destination, const int* tag, int timestamp, const float* score, size_t n)> Callback; // One call per tick, in tick order
+
+	struct Bucket {
+		int timestamp;
+		std::vector<int> source, destination, tag;
+	};
+
+	Core& core;
+	const int lateness; // In ticks, 0 means edges should be in order, as the cores expect
+	const Callback callback;
+	std::vector<Bucket> bucket; // Tick t is in bucket[Slot(t)]
+	std::vector<int> timestampBatch;
+	std::vector<float> scoreBatch;
+	int timestampLatest = INT_MIN; // Of all accepted edges
+	int timestampNext = INT_MIN; // Earliest tick not scored yet, earlier edges are late
+	uint64_t numPushed = 0; // # edges accepted
+	uint64_t numReordered = 0; // # accepted edges earlier than one accepted before them
+	uint64_t numLate = 0; // # edges dropped because their tick was already scored
+	uint64_t numScored = 0;
+
+	ReorderBuffer(Core& core, int lateness, Callback callback):
+		core(core),
+		lateness(lateness),
+		callback(callback),
+		bucket(lateness + 1) {
+		assert(lateness >= 0);
+	}
+
+	ReorderBuffer(const ReorderBuffer& b) = delete;
+	ReorderBuffer& operator=(const ReorderBuffer& b) = delete;
+
+	// Remaining edges are still scored
+	~ReorderBuffer() {
+		Flush();
+	}
+
+	int Slot(int timestamp) const {
+		const int i = timestamp % (lateness + 1);
+		return i < 0 ? i + lateness + 1 : i;
+	}
+
+	// tag is handed back with the score, e.g., the index of the record, false if late
+	bool Push(int source, int destination, int timestamp, int tag = 0) {
+		if (timestampLatest == INT_MIN)
+			timestampNext = timestamp - lateness; // The first edge may be late by the window too
+		if (timestamp < timestampNext) {
+			numLate++;
+			return false;
+		}
+		if (timestamp > timestampLatest) {
+			Release(timestamp - lateness);
+			timestampLatest = timestamp;
+		} else if (timestamp < timestampLatest) {
+			numReordered++;
+		}
+		Bucket& b = bucket[Slot(timestamp)];
+		assert(b.source.empty() || b.timestamp == timestamp);
+		b.timestamp = timestamp;
+		b.source.push_back(source);
+		b.destination.push_back(destination);
+		b.tag.push_back(tag);
+		numPushed++;
+		return true;
+	}
+
+	// Score every tick before until, only the held ones are visited, so a long gap costs no more than a window
+	void Release(int until) {
+		const long long end = std::min<long long>(until, static_cast<long long>(timestampNext) + lateness + 1);
+		for (long long t = timestampNext; t < end; t++)
+			Score(bucket[Slot(static_cast<int>(t))]);
+		timestampNext = std::max(timestampNext, until);
+	}
+
+	// Score everything held, later edges of these ticks are late
+	void Flush() {
+		if (timestampLatest != INT_MIN)
+			Release(timestampLatest + 1);
+	}
+
+	void Score(Bucket& b) {
+		const size_t n = b.source.size();
+		if (!n) return;
+		timestampBatch.assign(n, b.timestamp);
+		scoreBatch.resize(n);
+		core.ScoreBatch(b.source.data(), b.destination.data(), timestampBatch.data(), scoreBatch.data(), n);
+		callback(b.source.data(), b.destination.data(), b.tag.data(), b.timestamp, scoreBatch.data(), n);
+		numScored += n;
+		b.source.clear();
+		b.destination.clear();
+		b.tag.clear();
+	}
+};
+}
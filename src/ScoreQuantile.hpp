@@ -0,0 +1,165 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace MIDAS {
+// Log-bucket histogram of recent positive scores, DDSketch-style, a bucket is a power of 2 split into 2^bitsSub, so relative error is below 2^-bitsSub
+// The bucket of a score is the top bits of its float representation, a shift and a subtraction, no log()
+// Scores in [2^exponentMin, 2^exponentMax) have their own buckets, others go to the first or the last, 0, negative and NaN ones to zero
+// Every halfLife scores, all counts are halved, so old scores fade, memory is fixed, 1 KiB of buckets per 16 powers of 2
+struct ScoreHistogram {
+	constexpr static int bitsSub = 4;
+	constexpr static int exponentMin = -20;
+	constexpr static int exponentMax = 44; // MIDAS-F scores of DARPA stay below 2^40
+	constexpr static int numBucket = (exponentMax - exponentMin) << bitsSub;
+	constexpr static uint32_t bitsMin = uint32_t(exponentMin + 127) << 23; // Float bits of 2^exponentMin
+	const int halfLife;
+	int sinceHalving = 0;
+	float zero = 0; // Count of scores <= 0
+	float total = 0;
+	float count[numBucket];
+
+	explicit ScoreHistogram(int halfLife = 1 << 20): halfLife(halfLife) {
+		assert(halfLife > 0);
+		std::fill(count, count + numBucket, 0.f);
+	}
+
+	static int Bucket(float score) {
+		uint32_t bits;
+		std::memcpy(&bits, &score, sizeof(bits));
+		const int i = bits < bitsMin ? 0 : static_cast<int>((bits - bitsMin) >> (23 - bitsSub));
+		return i < numBucket ? i : numBucket - 1;
+	}
+
+	// Least score of the next bucket
+	static float UpperBound(int i) {
+		const uint32_t bits = bitsMin + (uint32_t(i + 1) << (23 - bitsSub));
+		float a;
+		std::memcpy(&a, &bits, sizeof(a));
+		return a;
+	}
+
+	void Add(float score) {
+		if (score > 0)
+			count[Bucket(score)]++;
+		else
+			zero++;
+		total++;
+		if (++sinceHalving == halfLife) {
+			for (int i = 0; i < numBucket; i++)
+				count[i] *= 0.5f;
+			zero *= 0.5f;
+			total *= 0.5f;
+			sinceHalving = 0;
+		}
+	}
+
+	// Upper bound of the bucket of the q-quantile, i.e., at most a fraction 1 - q of recent scores are above it, O(numBucket)
+	float Quantile(double q) const {
+		const double tail = (1 - q) * total;
+		double mass = 0;
+		for (int i = numBucket - 1; i >= 0; i--) {
+			if (mass + count[i] > tail) return UpperBound(i);
+			mass += count[i];
+		}
+		return 0;
+	}
+
+	// Fraction of recent scores at least as high as score's bucket, an empirical p-value, O(numBucket)
+	double PValue(float score) const {
+		if (!(score > 0)) return 1;
+		double mass = 0;
+		for (int i = Bucket(score); i < numBucket; i++)
+			mass += count[i];
+		return total > 0 ? mass / total : 1;
+	}
+};
+
+// P-value of a score under the null of a chi-square distribution of 1 degree of freedom, which MIDAS scores approximate
+inline double ChiSquarePValue(double score) {
+	return score > 0 ? std::erfc(std::sqrt(score / 2)) : 1;
+}
+
+// Least score whose ChiSquarePValue() is at most p, by bisection, for a fixed threshold
+inline float ChiSquareThreshold(double p) {
+	double low = 0, high = 1;
+	while (ChiSquarePValue(high) > p)
+		high *= 2;
+	for (int i = 0; i < 100; i++) {
+		const double middle = (low + high) / 2;
+		(ChiSquarePValue(middle) > p ? low : high) = middle;
+	}
+	return static_cast<float>(high);
+}
+
+// Alerts on scores of any core above the q-quantile of recent scores, and above floor, e.g., ChiSquareThreshold(p)
+// The threshold comes from the scores before each one, refreshed every lenRefresh scores, so a score costs a comparison and an Add()
+// No alert in the first lenWarmup scores, when the quantile is not known yet
+struct AdaptiveThreshold {
+	ScoreHistogram histogram;
+	const double quantile;
+	const float floor;
+	const int lenRefresh;
+	const uint64_t lenWarmup;
+	float threshold = std::numeric_limits<float>::infinity();
+	int sinceRefresh = 0;
+	uint64_t numScore = 0;
+	uint64_t numAlert = 0;
+
+	AdaptiveThreshold(double quantile, int halfLife = 1 << 20, int lenRefresh = 1 << 10, float floor = 0, uint64_t lenWarmup = 1 << 12):
+		histogram(halfLife),
+		quantile(quantile),
+		floor(floor),
+		lenRefresh(lenRefresh),
+		lenWarmup(lenWarmup) {
+		assert(quantile > 0 && quantile < 1 && lenRefresh > 0);
+	}
+
+	void Refresh() {
+		threshold = numScore < lenWarmup ? std::numeric_limits<float>::infinity() : std::max(histogram.Quantile(quantile), floor);
+		sinceRefresh = 0;
+	}
+
+	// Whether score is an alert, then it joins the recent scores
+	bool operator()(float score) {
+		const bool alert = score > threshold;
+		numAlert += alert;
+		histogram.Add(score);
+		numScore++;
+		if (++sinceRefresh == lenRefresh || numScore == lenWarmup)
+			Refresh();
+		return alert;
+	}
+
+	// Indices of alerts among n scores go to indexOut, return their count
+	size_t Batch(const float* score, size_t n, size_t* indexOut) {
+		size_t m = 0;
+		for (size_t i = 0; i < n; i++) {
+			indexOut[m] = i;
+			m += (*this)(score[i]);
+		}
+		return m;
+	}
+};
+}
@@ -0,0 +1,235 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "Barrier.hpp"
+#include "FilteringCore.hpp"
+
+namespace MIDAS {
+// FilteringCore scored by numThread threads, same hash parameters and same scores bit by bit
+// Cells of all CMSs are split into numThread contiguous slices, each thread only adds to, merges and assigns cells of its own slice,
+// cells are updated in the order of edges, so every cell sees the same sequence of float operations as in FilteringCore
+// Hashing a block is by edge, each thread also buckets its hashed cells by slice, so a slice's thread only visits its own cells later
+// Scores need the minimum of all rows, so a tick (a run of edges before the next merge) has three phases separated by barriers:
+// 1. By slice: merge if the timestamp advances, add the edges, record the current and total count of each hashed cell
+// 2. By edge: compute scores from the records
+// 3. By slice: assign scores to the score CMSs, needed by the next merge
+// Only ScoreBatch() is parallel, operator() is the serial one, both can be mixed
+template<int R = 0, class Hasher = ModuloHash>
+struct BasicShardedFilteringCore {
+	BasicFilteringCore<R, Hasher> core; // CMSs, hash parameters and timestamps, always dense merge
+	const int numThread;
+	constexpr static int lenBlock = 1 << 12; // # edges hashed and planned at once by ScoreBatch()
+	constexpr static int lenAlign = Kernel::alignment / sizeof(float); // Slices start at cache lines, no false sharing
+	int* const sliceBegin; // Cells [sliceBegin[s], sliceBegin[s + 1]) belong to thread s
+	int* const indexBlock; // Edge, source, destination, each has lenBlock * numRow
+	float* const currentBlock; // Current count of each hashed cell right after its edge is added, same layout as indexBlock
+	float* const totalBlock; // Total count of each hashed cell, same layout as indexBlock
+	float* const scoreBlock; // Edge, source, destination, each has lenBlock
+	std::vector<std::vector<int>> bucket; // [hashing thread h][slice t], offsets into indexBlock of cells in slice t from edges hashed by h, in edge order
+	std::vector<int> cursor; // [slice t][hashing thread h], next entry of bucket[h][t], only used by thread t
+	std::vector<int> cursorRun; // Same as cursor, at the beginning of the run, for the assignment
+
+	struct Run { // Edges between two merges
+		int begin, end;
+		bool merge; // Whether the run starts with a merge
+		float timestampReciprocal; // Used by the merge
+	};
+	Run* const run;
+	int numRun = 0;
+
+	// The block being scored, shared with workers
+	const int* sourceBlock = nullptr;
+	const int* destinationBlock = nullptr;
+	const int* timestampBlock = nullptr;
+	float* scoreOut = nullptr;
+	int lenCurrent = 0;
+	bool stop = false;
+
+	Barrier barrier;
+	std::vector<std::thread> worker;
+
+	BasicShardedFilteringCore(int numThread, int numRow, int numColumn, float threshold, float factor = 0.5):
+		BasicShardedFilteringCore(Random(), numThread, numRow, numColumn, threshold, factor) { }
+
+	// Hash parameters are drawn from random instead of the global rand(), e.g., Random(seed)
+	BasicShardedFilteringCore(Random random, int numThread, int numRow, int numColumn, float threshold, float factor = 0.5):
+		core(random, numRow, numColumn, threshold, factor),
+		numThread(numThread),
+		sliceBegin(new int[numThread + 1]),
+		indexBlock(new int[3 * lenBlock * numRow]),
+		currentBlock(new float[3 * lenBlock * numRow]),
+		totalBlock(new float[3 * lenBlock * numRow]),
+		scoreBlock(new float[3 * lenBlock]),
+		bucket(numThread * numThread),
+		cursor(numThread * numThread),
+		cursorRun(numThread * numThread),
+		run(new Run[lenBlock]),
+		barrier(numThread) {
+		for (int s = 0; s < numThread; s++)
+			sliceBegin[s] = static_cast<int>(1ll * core.lenData * s / numThread / lenAlign * lenAlign);
+		sliceBegin[numThread] = core.lenData;
+		for (int s = 1; s < numThread; s++) // The calling thread is the 0th
+			worker.emplace_back(&BasicShardedFilteringCore::Work, this, s);
+	}
+
+	BasicShardedFilteringCore(const BasicShardedFilteringCore& b) = delete;
+	BasicShardedFilteringCore& operator=(const BasicShardedFilteringCore& b) = delete;
+
+	virtual ~BasicShardedFilteringCore() {
+		stop = true;
+		barrier.Wait();
+		for (auto& w: worker)
+			w.join();
+		delete[] sliceBegin;
+		delete[] indexBlock;
+		delete[] currentBlock;
+		delete[] totalBlock;
+		delete[] scoreBlock;
+		delete[] run;
+	}
+
+	void Work(int s) {
+		while (true) {
+			barrier.Wait(); // A block is ready
+			if (stop) return;
+			ScoreBlock(s);
+		}
+	}
+
+	// Same timestamp logic as FilteringCore::Score(), but only planned, workers do the merges
+	void Plan() {
+		numRun = 0;
+		for (int j = 0; j < lenCurrent; j++)
+			if (j == 0 || core.timestamp < timestampBlock[j]) {
+				if (numRun) run[numRun - 1].end = j;
+				run[numRun].begin = j;
+				run[numRun].merge = core.timestamp < timestampBlock[j];
+				run[numRun].timestampReciprocal = core.timestampReciprocal;
+				if (run[numRun].merge) {
+					core.timestampReciprocal = 1.f / (timestampBlock[j] - 1);
+					core.timestamp = timestampBlock[j];
+				}
+				numRun++;
+			}
+		run[numRun - 1].end = lenCurrent;
+	}
+
+	// Slice of a cell, slices are of about equal length, so the guess is at most one off
+	int SliceOf(int cell) const {
+		int t = static_cast<int>(1ll * cell * numThread / core.lenData);
+		while (t + 1 < numThread && sliceBegin[t + 1] <= cell) t++;
+		while (cell < sliceBegin[t]) t--;
+		return t;
+	}
+
+	// Done by each thread s, ends with a barrier
+	void ScoreBlock(int s) {
+		const int r = core.numCurrentEdge.NumRow();
+		const BasicCountMinSketch<R, Hasher>* const current[3] = {&core.numCurrentEdge, &core.numCurrentSource, &core.numCurrentDestination};
+		const BasicCountMinSketch<R, Hasher>* const total[3] = {&core.numTotalEdge, &core.numTotalSource, &core.numTotalDestination};
+		const BasicCountMinSketch<R, Hasher>* const score[3] = {&core.scoreEdge, &core.scoreSource, &core.scoreDestination};
+		const int begin = sliceBegin[s], end = sliceBegin[s + 1];
+		std::vector<int>* const bucketOut = &bucket[s * numThread]; // Filled by this thread
+		int* const cursorIn = &cursor[s * numThread]; // Into bucket[h][s] of every h
+		int* const cursorRunIn = &cursorRun[s * numThread];
+
+		// Hash and bucket by slice, by edge
+		for (int t = 0; t < numThread; t++)
+			bucketOut[t].clear();
+		for (int j = lenCurrent * s / numThread, J = lenCurrent * (s + 1) / numThread; j < J; j++) {
+			core.numCurrentEdge.Hash(indexBlock + j * r, sourceBlock[j], destinationBlock[j]);
+			core.numCurrentSource.Hash(indexBlock + (lenBlock + j) * r, sourceBlock[j]);
+			core.numCurrentDestination.Hash(indexBlock + (2 * lenBlock + j) * r, destinationBlock[j]);
+			for (int f = 0; f < 3; f++)
+				for (int i = 0; i < r; i++) {
+					const int l = (f * lenBlock + j) * r + i;
+					bucketOut[SliceOf(indexBlock[l])].push_back(l);
+				}
+		}
+		std::fill(cursorIn, cursorIn + numThread, 0);
+		barrier.Wait();
+
+		for (int k = 0; k < numRun; k++) {
+			// Merge, add and record, by slice, buckets of edges hashed by earlier threads hold earlier edges, so cells see edges in order
+			if (run[k].merge)
+				for (int f = 0; f < 3; f++)
+					Kernel::ConditionalMerge(current[f]->data + begin, total[f]->data + begin, score[f]->data + begin, end - begin, core.threshold, run[k].timestampReciprocal, core.factor);
+			std::copy(cursorIn, cursorIn + numThread, cursorRunIn);
+			for (int h = 0; h < numThread; h++) {
+				const std::vector<int>& b = bucket[h * numThread + s];
+				int& c = cursorIn[h];
+				for (; c < static_cast<int>(b.size()) && b[c] / r % lenBlock < run[k].end; c++) {
+					const int l = b[c];
+					const int f = l / r / lenBlock;
+					const int cell = indexBlock[l];
+					currentBlock[l] = current[f]->data[cell] += 1;
+					totalBlock[l] = total[f]->data[cell];
+				}
+			}
+			barrier.Wait();
+
+			// Score, by edge
+			for (int j = run[k].begin + (run[k].end - run[k].begin) * s / numThread, J = run[k].begin + (run[k].end - run[k].begin) * (s + 1) / numThread; j < J; j++) {
+				for (int f = 0; f < 3; f++) {
+					float a = BasicCountMinSketch<R, Hasher>::infinity, t = a;
+					for (int i = 0; i < r; i++) {
+						a = std::min(a, currentBlock[(f * lenBlock + j) * r + i]);
+						t = std::min(t, totalBlock[(f * lenBlock + j) * r + i]);
+					}
+					scoreBlock[f * lenBlock + j] = core.ComputeScore(a, t, timestampBlock[j]);
+				}
+				scoreOut[j] = std::max({scoreBlock[j], scoreBlock[lenBlock + j], scoreBlock[2 * lenBlock + j]});
+			}
+			barrier.Wait();
+
+			// Assign, by slice, the same entries as the addition, the last edge of a cell wins as in FilteringCore
+			for (int h = 0; h < numThread; h++) {
+				const std::vector<int>& b = bucket[h * numThread + s];
+				for (int c = cursorRunIn[h]; c < cursorIn[h]; c++) {
+					const int l = b[c];
+					score[l / r / lenBlock]->data[indexBlock[l]] = scoreBlock[l / r];
+				}
+			}
+		}
+		barrier.Wait(); // Block is done
+	}
+
+	float operator()(int source, int destination, int timestamp) {
+		return core(source, destination, timestamp);
+	}
+
+	void ScoreBatch(const int* source, const int* destination, const int* timestamp, float* scoreOut, size_t n) {
+		for (size_t i = 0; i < n; i += lenBlock) {
+			sourceBlock = source + i;
+			destinationBlock = destination + i;
+			timestampBlock = timestamp + i;
+			this->scoreOut = scoreOut + i;
+			lenCurrent = static_cast<int>(std::min<size_t>(lenBlock, n - i));
+			Plan();
+			barrier.Wait(); // Release workers
+			ScoreBlock(0);
+		}
+	}
+};
+
+typedef BasicShardedFilteringCore<> ShardedFilteringCore;
+}
@@ -0,0 +1,311 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "CountMinSketch.hpp"
+
+// Binary snapshot of a core, all little-endian, written by a SnapshotPlan and mapped by a Snapshot
+// [0, 256): SnapshotHeader, zero-padded
+// [offsetSketch[k], +pad(r * sizeParam)): param1 of the k-th CMS, then param2, then cells, each starts at a multiple of 64 bytes
+// CMSs are in the order of the core's fields, e.g., current, total, score of edges, then of sources, then of destinations
+// The file is mapped copy-on-write, so a restored core uses the cells in place, and its updates never reach the file
+
+namespace MIDAS {
+enum SnapshotCore: uint32_t {
+	SnapshotNormal = 1,
+	SnapshotRelational = 2,
+	SnapshotFiltering = 3,
+};
+
+struct SnapshotHeader {
+	char magic[8]; // "MIDASSNP"
+	uint32_t version;
+	uint32_t lenHeader; // Bytes before the first CMS
+	uint32_t core; // SnapshotCore
+	int32_t numRow, numColumn;
+	uint32_t sizeParam; // Bytes of a hash parameter
+	uint32_t hash; // Id of the hash policy
+	uint32_t numSketch;
+	uint32_t sizeCell[9]; // Bytes of a cell of each CMS
+	uint32_t storage[9]; // Id of the storage policy of each CMS
+	uint64_t offsetSketch[9]; // Bytes from the beginning of the file
+	int32_t timestamp;
+	float timestampReciprocal; // FilteringCore only
+	float threshold; // FilteringCore only
+	float factor; // RelationalCore and FilteringCore
+};
+
+constexpr char snapshotMagic[8] = {'M', 'I', 'D', 'A', 'S', 'S', 'N', 'P'};
+constexpr uint32_t snapshotVersion = 2; // 2: ids of hash and storage policies
+constexpr uint64_t snapshotLenHeader = 256;
+constexpr uint64_t snapshotAlignment = 64;
+constexpr int snapshotMaxSketch = 9;
+static_assert(sizeof(SnapshotHeader) <= snapshotLenHeader, "Header should fit in its reserved bytes");
+
+inline uint64_t SnapshotPad(uint64_t size) {
+	return (size + snapshotAlignment - 1) / snapshotAlignment * snapshotAlignment;
+}
+
+// What to write, filled by Plan() of a core, only pointers are recorded
+// Prepare() formats the temporary path, then Commit() allocates nothing and only calls open(), write(), fsync(), close() and rename(), so it is safe after fork()
+struct SnapshotPlan {
+	struct Region {
+		const void* address;
+		uint64_t size;
+	};
+
+	SnapshotHeader header;
+	Region region[3 * snapshotMaxSketch]; // param1, param2, cells of each CMS
+	uint64_t size = snapshotLenHeader; // Bytes of the file
+	char pathTemp[4096]; // path.tmp, see Prepare()
+
+	void Begin(SnapshotCore core, int numRow, int numColumn, int timestamp, float timestampReciprocal = 0, float threshold = 0, float factor = 0) {
+		header = {};
+		std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+		header.version = snapshotVersion;
+		header.lenHeader = snapshotLenHeader;
+		header.core = core;
+		header.numRow = numRow;
+		header.numColumn = numColumn;
+		header.timestamp = timestamp;
+		header.timestampReciprocal = timestampReciprocal;
+		header.threshold = threshold;
+		header.factor = factor;
+		size = snapshotLenHeader;
+	}
+
+	template<int R, class Hasher, class Storage>
+	void Add(const BasicCountMinSketch<R, Hasher, Storage>& sketch) {
+		typedef typename Hasher::Param Param;
+		typedef typename Storage::Cell Cell;
+		const int k = header.numSketch++;
+		const uint64_t lenParam = sizeof(Param) * sketch.r;
+		header.sizeParam = sizeof(Param);
+		header.hash = Hasher::id;
+		header.sizeCell[k] = sizeof(Cell);
+		header.storage[k] = Storage::id;
+		header.offsetSketch[k] = size;
+		region[3 * k] = {sketch.param1, lenParam};
+		region[3 * k + 1] = {sketch.param2, lenParam};
+		region[3 * k + 2] = {sketch.data, sizeof(Cell) * sketch.lenData};
+		size += 2 * SnapshotPad(lenParam) + SnapshotPad(sizeof(Cell) * sketch.lenData);
+	}
+
+	// Return false if path is too long, snprintf() is not async-signal-safe, so it is called before fork()
+	bool Prepare(const char* path) {
+		return std::snprintf(pathTemp, sizeof(pathTemp), "%s.tmp", path) < static_cast<int>(sizeof(pathTemp));
+	}
+
+	// Written to path.tmp, then renamed to path, so a reader never sees a partial snapshot, return false on I/O errors
+	bool Write(const char* path) {
+		return Prepare(path) && Commit(path);
+	}
+
+	// Same, path should be the one given to Prepare()
+	bool Commit(const char* path) const {
+		static const char padding[snapshotLenHeader] = {};
+#ifdef _WIN32
+		const auto file = fopen(pathTemp, "wb");
+		if (!file) return false;
+		const auto Put = [&](const void* p, uint64_t n) { return fwrite(p, 1, n, file) == n; };
+#else
+		const int file = open(pathTemp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (file < 0) return false;
+		const auto Put = [&](const void* p, uint64_t n) {
+			for (const char* q = static_cast<const char*>(p); n;) {
+				const ssize_t m = write(file, q, n);
+				if (m <= 0) return false;
+				q += m;
+				n -= m;
+			}
+			return true;
+		};
+#endif
+		bool ok = Put(&header, sizeof(header)) && Put(padding, snapshotLenHeader - sizeof(header));
+		for (uint32_t i = 0; i < 3 * header.numSketch; i++)
+			ok = ok && Put(region[i].address, region[i].size) && Put(padding, SnapshotPad(region[i].size) - region[i].size);
+#ifdef _WIN32
+		ok = fclose(file) == 0 && ok;
+		return ok && MoveFileExA(pathTemp, path, MOVEFILE_REPLACE_EXISTING);
+#else
+		ok = fsync(file) == 0 && ok;
+		ok = close(file) == 0 && ok;
+		return ok && rename(pathTemp, path) == 0;
+#endif
+	}
+};
+
+// Copy-on-write mapping of a snapshot, header is nullptr if the file is missing or not a snapshot
+// Restored cores point into it, so it should outlive them
+struct Snapshot {
+	const SnapshotHeader* header = nullptr;
+	void* address = nullptr;
+	size_t size = 0;
+
+	explicit Snapshot(const char* path) {
+#ifdef _WIN32
+		const HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return;
+		LARGE_INTEGER lenFile;
+		if (GetFileSizeEx(file, &lenFile) && lenFile.QuadPart > 0) {
+			const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+			if (mapping) {
+				address = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+				CloseHandle(mapping); // The view keeps the mapping alive
+			}
+			size = address ? static_cast<size_t>(lenFile.QuadPart) : 0;
+		}
+		CloseHandle(file);
+#else
+		const int file = open(path, O_RDONLY);
+		if (file < 0) return;
+		struct stat status;
+		if (fstat(file, &status) == 0 && status.st_size > 0) {
+			address = mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+			if (address == MAP_FAILED)
+				address = nullptr;
+			else
+				size = status.st_size;
+		}
+		close(file); // The mapping keeps the file alive
+#endif
+		if (!address || size < snapshotLenHeader) return;
+		const auto h = static_cast<const SnapshotHeader*>(address);
+		if (std::memcmp(h->magic, snapshotMagic, sizeof(h->magic)) || h->version != snapshotVersion || h->numSketch > snapshotMaxSketch || h->numRow <= 0 || h->numColumn <= 0)
+			return;
+		for (uint32_t k = 0; k < h->numSketch; k++)
+			if (h->offsetSketch[k] + 2 * SnapshotPad(uint64_t(h->sizeParam) * h->numRow) + uint64_t(h->sizeCell[k]) * h->numRow * h->numColumn > size)
+				return;
+		header = h;
+	}
+
+	Snapshot(const Snapshot& b) = delete;
+	Snapshot& operator=(const Snapshot& b) = delete;
+
+	~Snapshot() {
+		if (!address) return;
+#ifdef _WIN32
+		UnmapViewOfFile(address);
+#else
+		munmap(address, size);
+#endif
+	}
+
+	// Whether a core of this kind, hash policy and storage policies can be restored from it, sizes are checked too, as View() relies on them
+	bool Fits(SnapshotCore core, uint32_t numSketch, uint32_t hash, uint32_t sizeParam, const uint32_t* storage, const uint32_t* sizeCell) const {
+		if (!header || header->core != core || header->numSketch != numSketch || header->hash != hash || header->sizeParam != sizeParam) return false;
+		for (uint32_t k = 0; k < numSketch; k++)
+			if (header->storage[k] != storage[k] || header->sizeCell[k] != sizeCell[k]) return false;
+		return true;
+	}
+
+	SketchView View(int k) const {
+		char* const p = static_cast<char*>(address) + header->offsetSketch[k];
+		const uint64_t lenParam = SnapshotPad(uint64_t(header->sizeParam) * header->numRow);
+		return {header->numRow, header->numColumn, p, p + lenParam, p + 2 * lenParam};
+	}
+};
+
+// A child process writes the snapshot from its copy-on-write view of memory, the scoring thread only pays for fork()
+// Without fork(), i.e., on Windows, the snapshot is written before returning
+struct BackgroundSnapshot {
+	long long pid = -1; // -1 if already done
+	bool ok = false;
+
+	BackgroundSnapshot() = default;
+	BackgroundSnapshot(const BackgroundSnapshot& b) = delete;
+	BackgroundSnapshot& operator=(const BackgroundSnapshot& b) = delete;
+
+	BackgroundSnapshot(BackgroundSnapshot&& b): pid(b.pid), ok(b.ok) {
+		b.pid = -1;
+	}
+
+	// The previous child is reaped first, e.g., job = SaveInBackground(midas, path) of periodic snapshots
+	BackgroundSnapshot& operator=(BackgroundSnapshot&& b) {
+		if (this != &b) {
+			Wait();
+			pid = b.pid;
+			ok = b.ok;
+			b.pid = -1;
+		}
+		return *this;
+	}
+
+	// A dropped job is reaped, so it never leaves a zombie, but this blocks until the child exits
+	~BackgroundSnapshot() {
+		Wait();
+	}
+
+	// Whether the snapshot was written, blocks until it is
+	bool Wait() {
+#ifndef _WIN32
+		if (pid > 0) {
+			int status = 0;
+			ok = waitpid(static_cast<pid_t>(pid), &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+			pid = -1;
+		}
+#endif
+		return ok;
+	}
+};
+
+// Core should have Plan(SnapshotPlan&), which also brings lazy cells up to date, return false on I/O errors
+template<class Core>
+bool SaveSnapshot(Core& core, const char* path) {
+	SnapshotPlan plan;
+	core.Plan(plan);
+	return plan.Write(path);
+}
+
+// Same as SaveSnapshot(), Plan() and Prepare() are called before fork(), so the core can be scored again as soon as it returns
+template<class Core>
+BackgroundSnapshot SaveInBackground(Core& core, const char* path) {
+	BackgroundSnapshot job;
+	SnapshotPlan plan;
+	core.Plan(plan);
+	if (!plan.Prepare(path)) return job;
+#ifdef _WIN32
+	job.ok = plan.Commit(path);
+#else
+	const pid_t pid = fork();
+	if (pid == 0)
+		_exit(plan.Commit(path) ? 0 : 1); // No destructor, no atexit handler, no stdio flush of the parent's buffers, no lock another thread may hold
+	if (pid < 0)
+		job.ok = plan.Commit(path); // Out of processes, write it now
+	else
+		job.pid = pid;
+#endif
+	return job;
+}
+}
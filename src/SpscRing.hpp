@@ -0,0 +1,79 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+namespace MIDAS {
+// Bounded lock-free ring of one producer thread and one consumer thread, T should be trivially copyable
+// Each side caches the other's index, so the shared cache line is only touched when the cached one says full or empty
+template<class T>
+struct SpscRing {
+	const size_t mask; // Capacity - 1, capacity is a power of 2
+	T* const item;
+	char padding0[64]; // Padding instead of alignas(), C++11 new does not honor over-alignment
+	std::atomic<size_t> head; // Next to pop, written by the consumer
+	size_t tailCached = 0; // Consumer's copy of tail
+	char padding1[64];
+	std::atomic<size_t> tail; // Next to push, written by the producer
+	size_t headCached = 0; // Producer's copy of head
+	char padding2[64];
+
+	explicit SpscRing(size_t capacity):
+		mask(capacity - 1),
+		item(new T[capacity]),
+		head(0),
+		tail(0) {
+		assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+	}
+
+	SpscRing(const SpscRing& b) = delete;
+	SpscRing& operator=(const SpscRing& b) = delete;
+
+	~SpscRing() {
+		delete[] item;
+	}
+
+	// Producer side
+	bool TryPush(const T& a) {
+		const size_t t = tail.load(std::memory_order_relaxed);
+		if (t - headCached > mask) {
+			headCached = head.load(std::memory_order_acquire);
+			if (t - headCached > mask) return false; // Full
+		}
+		item[t & mask] = a;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side, nullptr if empty, call Pop() after the item is used
+	const T* Front() {
+		const size_t h = head.load(std::memory_order_relaxed);
+		if (h == tailCached) {
+			tailCached = tail.load(std::memory_order_acquire);
+			if (h == tailCached) return nullptr;
+		}
+		return item + (h & mask);
+	}
+
+	void Pop() {
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+};
+}
@@ -0,0 +1,126 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "Kernel.hpp"
+
+// A storage policy decides how a CMS cell is kept in memory, all arithmetic is still done in float
+// - typedef Cell: type of a cell
+// - constexpr static uint32_t id: saved in snapshots, so a core is only restored with the policy it was saved with
+// - static float Load(Cell a)
+// - static Cell Store(float a): round, and saturate if the range is limited
+// - static void Fill(Cell* data, size_t n, float with)
+// - static void Scale(Cell* data, size_t n, float by)
+
+namespace MIDAS {
+// The original storage, 4 bytes per cell, and the only one with SIMD sweeps
+struct FloatStorage {
+	typedef float Cell;
+	constexpr static uint32_t id = 1;
+
+	static float Load(Cell a) {
+		return a;
+	}
+
+	static Cell Store(float a) {
+		return a;
+	}
+
+	static void Fill(Cell* data, size_t n, float with) {
+		Kernel::Fill(data, n, with);
+	}
+
+	static void Scale(Cell* data, size_t n, float by) {
+		Kernel::Scale(data, n, by);
+	}
+};
+
+// Unsigned fixed point with FractionBit bits after the binary point, rounded to nearest even, saturated to [0, max]
+// Counts are never negative, so no sign bit is wasted
+// Ties go to even, otherwise a decayed cell would be stuck at the smallest step, e.g., 1/16 * 0.5 rounded up to 1/16
+template<class Int, int FractionBit>
+struct FixedStorage {
+	static_assert(std::is_unsigned<Int>::value && sizeof(Int) <= 4, "Cells should be unsigned and at most 32-bit");
+	typedef Int Cell;
+	constexpr static uint32_t id = 0x100 * sizeof(Int) + FractionBit; // Never 1 or 2
+	constexpr static float scale = static_cast<float>(1ull << FractionBit);
+	constexpr static float maxFixed = sizeof(Int) < 4 ? static_cast<float>(std::numeric_limits<Int>::max()) : 4294967040.f; // The largest float not above the max of Int
+
+	static float Load(Cell a) {
+		return a / scale; // Division by a power of 2 is exact
+	}
+
+	static Cell Store(float a) {
+		float fixed = a * scale;
+		fixed = fixed > 0 ? fixed : 0;
+		fixed = fixed < maxFixed ? fixed : maxFixed;
+		if (fixed < 8388608.f) // Adding 2^23 drops the fraction with the current rounding mode, floats above are integers already
+			fixed = fixed + 8388608.f - 8388608.f;
+		return static_cast<Int>(static_cast<int64_t>(fixed));
+	}
+
+	static void Fill(Cell* data, size_t n, float with) {
+		const Cell cell = Store(with);
+		for (size_t i = 0; i < n; i++)
+			data[i] = cell;
+	}
+
+	static void Scale(Cell* data, size_t n, float by) {
+		for (size_t i = 0; i < n; i++)
+			data[i] = Store(Load(data[i]) * by);
+	}
+};
+
+typedef FixedStorage<uint16_t, 4> Fixed16Storage; // 1/16 resolution, up to 4095
+typedef FixedStorage<uint32_t, 8> Fixed32Storage; // 1/256 resolution, exact up to 2^16, saturates at 2^24
+
+// Top 16 bits of a float, rounded to nearest even, same range as float but only 8 significant bits
+// Counters stop growing at 256 (256 + 1 rounds back to 256), so it suits score CMSs, not count CMSs
+struct BFloat16Storage {
+	typedef uint16_t Cell;
+	constexpr static uint32_t id = 2;
+
+	static float Load(Cell a) {
+		const uint32_t bit = static_cast<uint32_t>(a) << 16;
+		float f;
+		std::memcpy(&f, &bit, sizeof(f));
+		return f;
+	}
+
+	static Cell Store(float a) {
+		uint32_t bit;
+		std::memcpy(&bit, &a, sizeof(bit));
+		return static_cast<Cell>((bit + 0x7FFF + (bit >> 16 & 1)) >> 16); // Scores are never NaN
+	}
+
+	static void Fill(Cell* data, size_t n, float with) {
+		const Cell cell = Store(with);
+		for (size_t i = 0; i < n; i++)
+			data[i] = cell;
+	}
+
+	static void Scale(Cell* data, size_t n, float by) {
+		for (size_t i = 0; i < n; i++)
+			data[i] = Store(Load(data[i]) * by);
+	}
+};
+}
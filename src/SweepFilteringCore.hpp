@@ -0,0 +1,143 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "FilteringCore.hpp"
+
+namespace MIDAS {
+// numConfig FilteringCores of different (threshold, factor), scored in one pass over the edges
+// Hash parameters only depend on the seed, so each edge is hashed once and every configuration uses the same cells
+// Configurations are the innermost dimension, so a hashed cell of all configurations is a contiguous run of floats,
+// loaded once per edge, and every per-cell loop runs across configurations, i.e., vectorized
+// Scores of configuration k are the same as FilteringCore(numRow, numColumn, threshold[k], factor[k]) under the same seed
+template<int R = 0, class Hasher = ModuloHash>
+struct BasicSweepFilteringCore {
+	constexpr static int lenLane = 8; // Configurations are padded to a multiple of an AVX2 register
+	static_assert(Kernel::lenPeriod % lenLane == 0, "A period of lenLane-padded configurations should fit the widest vector");
+	const int numConfig;
+	const int lenConfig; // numConfig rounded up to lenLane
+	const int period; // A multiple of lenConfig and Kernel::lenPeriod
+	float* const threshold; // Repeated to period for Kernel::ConditionalMergePeriodic(), padding lanes have threshold 0 and factor 0, so their cells stay 0
+	float* const factor;
+	int timestamp = 1;
+	float timestampReciprocal = 0;
+	const BasicCountMinSketch<R, Hasher> hashEdge, hashSource, hashDestination; // Only for hash parameters, drawn in the same order as FilteringCore
+	const int lenData;
+	float* const data; // [edge/source/destination][current/total/score][cell][configuration], 64-byte aligned
+	IndexArray<R> indexEdge;
+	IndexArray<R> indexSource;
+	IndexArray<R> indexDestination;
+	float* const score; // Per-configuration scores of a CMS family of the edge being scored, lenConfig
+
+	// threshold and factor are per configuration, of the same length
+	BasicSweepFilteringCore(int numRow, int numColumn, const std::vector<float>& threshold, const std::vector<float>& factor):
+		BasicSweepFilteringCore(Random(), numRow, numColumn, threshold, factor) { }
+
+	// Hash parameters are drawn from random instead of the global rand(), e.g., Random(seed)
+	BasicSweepFilteringCore(Random random, int numRow, int numColumn, const std::vector<float>& threshold, const std::vector<float>& factor):
+		numConfig(static_cast<int>(threshold.size())),
+		lenConfig((numConfig + lenLane - 1) / lenLane * lenLane),
+		period(lenConfig % Kernel::lenPeriod ? lenConfig * Kernel::lenPeriod / lenLane : lenConfig),
+		threshold(Kernel::AlignedNew<float>(period)),
+		factor(Kernel::AlignedNew<float>(period)),
+		hashEdge(numRow, numColumn, random),
+		hashSource(numRow, numColumn, random),
+		hashDestination(numRow, numColumn, random),
+		lenData(numRow * numColumn),
+		data(Kernel::AlignedNew<float>(9ull * lenData * lenConfig)),
+		indexEdge(numRow),
+		indexSource(numRow),
+		indexDestination(numRow),
+		score(Kernel::AlignedNew<float>(lenConfig)) {
+		assert(threshold.size() == factor.size());
+		std::fill(this->threshold, this->threshold + period, 0);
+		std::fill(this->factor, this->factor + period, 0);
+		for (int i = 0; i < period; i += lenConfig) {
+			std::copy(threshold.begin(), threshold.end(), this->threshold + i);
+			std::copy(factor.begin(), factor.end(), this->factor + i);
+		}
+		Kernel::Fill(data, 9ull * lenData * lenConfig, 0);
+		Kernel::Fill(score, lenConfig, 0);
+	}
+
+	// Same factor for all configurations
+	BasicSweepFilteringCore(int numRow, int numColumn, const std::vector<float>& threshold, float factor = 0.5):
+		BasicSweepFilteringCore(Random(), numRow, numColumn, threshold, std::vector<float>(threshold.size(), factor)) { }
+
+	BasicSweepFilteringCore(Random random, int numRow, int numColumn, const std::vector<float>& threshold, float factor = 0.5):
+		BasicSweepFilteringCore(random, numRow, numColumn, threshold, std::vector<float>(threshold.size(), factor)) { }
+
+	BasicSweepFilteringCore(const BasicSweepFilteringCore& b) = delete;
+	BasicSweepFilteringCore& operator=(const BasicSweepFilteringCore& b) = delete;
+
+	virtual ~BasicSweepFilteringCore() {
+		Kernel::AlignedDelete(threshold);
+		Kernel::AlignedDelete(factor);
+		Kernel::AlignedDelete(data);
+		Kernel::AlignedDelete(score);
+	}
+
+	int NumRow() const {
+		return hashEdge.NumRow();
+	}
+
+	// f: 0 edge, 1 source, 2 destination, kind: 0 current, 1 total, 2 score
+	float* Data(int f, int kind) const {
+		return data + (f * 3ull + kind) * lenData * lenConfig;
+	}
+
+	// Scores of all configurations go to scoreOut[0, numConfig)
+	void Score(const int* indexEdge, const int* indexSource, const int* indexDestination, int timestamp, float* scoreOut) {
+		if (this->timestamp < timestamp) {
+			for (int f = 0; f < 3; f++)
+				Kernel::ConditionalMergePeriodic(Data(f, 0), Data(f, 1), Data(f, 2), size_t(lenData) * lenConfig, threshold, factor, period, timestampReciprocal);
+			timestampReciprocal = 1.f / (timestamp - 1);
+			this->timestamp = timestamp;
+		}
+		const int* const index[3] = {indexEdge, indexSource, indexDestination};
+		for (int f = 0; f < 3; f++) {
+			for (int k = 0; k < lenConfig; k += lenLane) // Padding lanes get score 0
+				BasicFilteringCore<R, Hasher>::template Update<lenLane>(Data(f, 0) + k, Data(f, 1) + k, Data(f, 2) + k, index[f], NumRow(), timestamp, lenConfig, score + k);
+			for (int k = 0; k < numConfig; k++)
+				scoreOut[k] = f ? std::max(scoreOut[k], score[k]) : score[k];
+		}
+	}
+
+	void operator()(int source, int destination, int timestamp, float* scoreOut) {
+		hashEdge.Hash(indexEdge, source, destination);
+		hashSource.Hash(indexSource, source);
+		hashDestination.Hash(indexDestination, destination);
+		Score(indexEdge, indexSource, indexDestination, timestamp, scoreOut);
+	}
+
+	// scoreOut[k] receives n scores of configuration k
+	void ScoreBatch(const int* source, const int* destination, const int* timestamp, float* const* scoreOut, size_t n) {
+		std::vector<float> scoreEdge(numConfig);
+		for (size_t i = 0; i < n; i++) {
+			(*this)(source[i], destination[i], timestamp[i], scoreEdge.data());
+			for (int k = 0; k < numConfig; k++)
+				scoreOut[k][i] = scoreEdge[k];
+		}
+	}
+};
+
+typedef BasicSweepFilteringCore<> SweepFilteringCore;
+}
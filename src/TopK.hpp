@@ -0,0 +1,288 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace MIDAS {
+struct TopKEntry {
+	uint64_t key;
+	float score;
+};
+
+// The numTop keys of the highest scores so far, e.g., nodes or edges, updated by the scoring thread after each record
+// A key's score is the max of its records' scores, decayed by factor per tick, 1 keeps the all-time max, 0 only the current tick
+// Decay is implicit, stored scores are multiplied by scale, which grows by 1 / factor per tick,
+// when scale or a new stored score reaches maxStored, all are divided by scale, so they never overflow, at most once per log(maxStored / score) / log(1 / factor) ticks
+// A min-heap of numTop entries with an open-addressing index, a record below the heap's least score costs one comparison
+// At the end of each tick, heap positions changed in the tick and the scale are published under a sequence lock,
+// so a tick costs O(# changed positions), not O(numTop), and Query() copies them from any thread without stopping the scorer
+struct TopK {
+	const int numTop;
+	const float factor;
+	int timestamp = 1;
+	float scale = 1; // Stored score = score * scale
+	struct Item {
+		uint64_t key;
+		float score; // Stored
+		int slot; // In the index, so moving an item needs no probe
+	};
+	std::vector<Item> heap; // Min-heap of stored scores
+	const uint64_t mask; // # index slots - 1, a power of 2 of at least 2 * numTop
+	std::vector<uint64_t> indexKey;
+	std::vector<int> indexHeap; // Position in heap, -1 if the slot is empty
+	std::vector<int> dirty; // Heap positions changed since the last publish
+	std::vector<char> isDirty;
+	std::atomic<uint64_t> sequence; // Odd while publishing
+	std::atomic<int> numPublished;
+	std::atomic<uint32_t> publishedScale; // Bits of float, published scores are stored ones
+	std::unique_ptr<std::atomic<uint64_t>[]> publishedKey;
+	std::unique_ptr<std::atomic<uint32_t>[]> publishedScore; // Bits of float
+
+	constexpr static float maxStored = 1e30f; // Beyond this, scale and stored scores are rescaled, far below FLT_MAX, so they never overflow
+
+	static uint64_t LenIndex(int numTop) {
+		uint64_t a = 2;
+		while (a < 2ull * numTop)
+			a <<= 1;
+		return a;
+	}
+
+	explicit TopK(int numTop, float factor = 1):
+		numTop(numTop),
+		factor(factor),
+		mask(LenIndex(numTop) - 1),
+		indexKey(mask + 1),
+		indexHeap(mask + 1, -1),
+		isDirty(numTop, 0),
+		sequence(0),
+		numPublished(0),
+		publishedScale(0x3F800000), // 1.f
+		publishedKey(new std::atomic<uint64_t>[numTop]),
+		publishedScore(new std::atomic<uint32_t>[numTop]) {
+		assert(numTop > 0);
+		heap.reserve(numTop);
+		dirty.reserve(numTop);
+	}
+
+	TopK(const TopK& b) = delete;
+	TopK& operator=(const TopK& b) = delete;
+
+	static uint64_t Slot(uint64_t key) {
+		return (key ^ key >> 31) * 0x9E3779B97F4A7C15ull >> 20; // Only the low bits are used, after the multiplication mixed them
+	}
+
+	// Slot of key in the index, or of the empty slot where it would be
+	uint64_t Find(uint64_t key) const {
+		uint64_t i = Slot(key) & mask;
+		while (indexHeap[i] >= 0 && indexKey[i] != key)
+			i = (i + 1) & mask;
+		return i;
+	}
+
+	// Backward-shift deletion, so linear probing needs no tombstone
+	void Erase(uint64_t i) {
+		indexHeap[i] = -1;
+		for (uint64_t j = (i + 1) & mask; indexHeap[j] >= 0; j = (j + 1) & mask) {
+			const uint64_t home = Slot(indexKey[j]) & mask;
+			if (((j - home) & mask) >= ((j - i) & mask)) { // j's probe passes through i, so it can move there
+				indexKey[i] = indexKey[j];
+				indexHeap[i] = indexHeap[j];
+				heap[indexHeap[i]].slot = static_cast<int>(i);
+				indexHeap[j] = -1;
+				i = j;
+			}
+		}
+	}
+
+	void Place(int p, const Item& item) {
+		heap[p] = item;
+		indexHeap[item.slot] = p;
+		if (!isDirty[p]) {
+			isDirty[p] = 1;
+			dirty.push_back(p);
+		}
+	}
+
+	// Divide stored scores by scale, every position changes
+	void Rescale() {
+		for (int p = 0; p < static_cast<int>(heap.size()); p++)
+			Place(p, {heap[p].key, heap[p].score / scale, heap[p].slot});
+		scale = 1;
+	}
+
+	void SiftUp(int p) {
+		const Item entry = heap[p];
+		while (p) {
+			const int q = (p - 1) / 2;
+			if (heap[q].score <= entry.score) break;
+			Place(p, heap[q]);
+			p = q;
+		}
+		Place(p, entry);
+	}
+
+	void SiftDown(int p) {
+		const Item entry = heap[p];
+		const int n = static_cast<int>(heap.size());
+		while (true) {
+			int q = 2 * p + 1;
+			if (q >= n) break;
+			if (q + 1 < n && heap[q + 1].score < heap[q].score) q++;
+			if (entry.score <= heap[q].score) break;
+			Place(p, heap[q]);
+			p = q;
+		}
+		Place(p, entry);
+	}
+
+	// Publish the tick that ends, then decay, a gap of several ticks decays by factor^gap
+	void Advance(int timestamp) {
+		if (this->timestamp >= timestamp) return;
+		Publish();
+		if (factor == 0) {
+			for (const Item& item: heap) // Only occupied slots, so a tick costs O(# entries of the tick)
+				indexHeap[item.slot] = -1;
+			heap.clear();
+		} else if (factor != 1) {
+			scale /= std::pow(factor, static_cast<float>(timestamp - this->timestamp));
+			if (!(scale < maxStored)) // Also if scale is infinity
+				Rescale();
+		}
+		this->timestamp = timestamp;
+	}
+
+	void Update(uint64_t key, float score, int timestamp) {
+		Advance(timestamp);
+		float s = score * scale;
+		if (!(s < maxStored) && scale != 1) { // Stored scores stay finite, ties with the heap stay comparable
+			Rescale();
+			s = score;
+		}
+		const int n = static_cast<int>(heap.size());
+		if (n == numTop && s <= heap[0].score) return; // Neither a new entry nor a higher score of an existing one
+		const uint64_t i = Find(key);
+		if (indexHeap[i] >= 0) {
+			const int p = indexHeap[i];
+			if (heap[p].score < s) {
+				heap[p].score = s;
+				SiftDown(p); // A higher score moves away from the root of a min-heap
+			}
+		} else if (n < numTop) {
+			indexKey[i] = key;
+			heap.push_back({key, s, static_cast<int>(i)});
+			indexHeap[i] = n;
+			SiftUp(n);
+		} else {
+			Erase(heap[0].slot); // Evict the least
+			const uint64_t j = Find(key); // Erase() may have moved the slot
+			indexKey[j] = key;
+			indexHeap[j] = 0;
+			heap[0] = {key, s, static_cast<int>(j)};
+			SiftDown(0);
+		}
+	}
+
+	// Copy changed heap positions and the scale for Query(), called by Advance() on each tick, call it after the last record too
+	void Publish() {
+		const int n = static_cast<int>(heap.size());
+		uint32_t bitsScale;
+		std::memcpy(&bitsScale, &scale, sizeof(bitsScale));
+		sequence.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (const int p: dirty) {
+			if (p < n) {
+				uint32_t bits;
+				std::memcpy(&bits, &heap[p].score, sizeof(bits));
+				publishedKey[p].store(heap[p].key, std::memory_order_relaxed);
+				publishedScore[p].store(bits, std::memory_order_relaxed);
+			}
+			isDirty[p] = 0;
+		}
+		dirty.clear();
+		numPublished.store(n, std::memory_order_relaxed);
+		publishedScale.store(bitsScale, std::memory_order_relaxed);
+		sequence.fetch_add(1, std::memory_order_release);
+	}
+
+	// Entries of the last published tick, highest score first, any thread, O(numTop) copy, retried if a publish overlaps
+	void Query(std::vector<TopKEntry>& out) const {
+		while (true) {
+			const uint64_t begin = sequence.load(std::memory_order_acquire);
+			if (begin & 1) continue;
+			const int n = numPublished.load(std::memory_order_relaxed);
+			const uint32_t bitsScale = publishedScale.load(std::memory_order_relaxed);
+			float scale;
+			std::memcpy(&scale, &bitsScale, sizeof(scale));
+			out.resize(n);
+			for (int p = 0; p < n; p++) {
+				const uint32_t bits = publishedScore[p].load(std::memory_order_relaxed);
+				out[p].key = publishedKey[p].load(std::memory_order_relaxed);
+				std::memcpy(&out[p].score, &bits, sizeof(bits));
+				out[p].score /= scale;
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence.load(std::memory_order_relaxed) == begin) break;
+		}
+		std::sort(out.begin(), out.end(), [](const TopKEntry& a, const TopKEntry& b) { return a.score > b.score; });
+	}
+
+	// Entries as of now, highest score first, only on the scoring thread
+	void Top(std::vector<TopKEntry>& out) const {
+		out.resize(heap.size());
+		for (size_t p = 0; p < heap.size(); p++)
+			out[p] = {heap[p].key, heap[p].score / scale};
+		std::sort(out.begin(), out.end(), [](const TopKEntry& a, const TopKEntry& b) { return a.score > b.score; });
+	}
+};
+
+// Top sources, destinations and edges by the scores of their records, feed it every record with the score of any core
+// An edge's key is EdgeKey(source, destination)
+struct AnomalyReport {
+	TopK edge, source, destination;
+
+	explicit AnomalyReport(int numTop, float factor = 1): edge(numTop, factor), source(numTop, factor), destination(numTop, factor) { }
+
+	static uint64_t EdgeKey(int source, int destination) {
+		return uint64_t(uint32_t(source)) << 32 | uint32_t(destination);
+	}
+
+	void operator()(int source, int destination, int timestamp, float score) {
+		edge.Update(EdgeKey(source, destination), score, timestamp);
+		this->source.Update(uint32_t(source), score, timestamp);
+		this->destination.Update(uint32_t(destination), score, timestamp);
+	}
+
+	void Batch(const int* source, const int* destination, const int* timestamp, const float* score, size_t n) {
+		for (size_t i = 0; i < n; i++)
+			(*this)(source[i], destination[i], timestamp[i], score[i]);
+	}
+
+	void Publish() {
+		edge.Publish();
+		source.Publish();
+		destination.Publish();
+	}
+};
+}
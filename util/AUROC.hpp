@@ -24,87 +24,184 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
 
-/// @tparam T Type of array elements, should be a floating number type
+namespace AUROCDetail {
+/// Unsigned integer of the same width as T
+template<class T>
+struct KeyOf;
+
+template<>
+struct KeyOf<float> {
+	typedef uint32_t Type;
+};
+
+template<>
+struct KeyOf<double> {
+	typedef uint64_t Type;
+};
+
+/// Map a finite floating number to an unsigned integer of the same order, -0.0 and 0.0 are the same key
+template<class T>
+typename KeyOf<T>::Type Key(T a) {
+	typedef typename KeyOf<T>::Type K;
+	const K sign = K(1) << (sizeof(K) * 8 - 1);
+	K b;
+	a = a == 0 ? 0 : a;
+	std::memcpy(&b, &a, sizeof(b));
+	return b & sign ? ~b : b | sign;
+}
+
+/// LSD radix sort of 11-bit digits, scratch has n elements, digits shared by all keys are skipped
+template<class K>
+void RadixSort(K* key, K* scratch, size_t n) {
+	constexpr int lenDigit = 11;
+	constexpr int numBucket = 1 << lenDigit;
+	constexpr int numPass = (sizeof(K) * 8 + lenDigit - 1) / lenDigit;
+	K* const out = key;
+	std::vector<size_t> count(numPass * numBucket, 0); // All histograms in one read
+	for (size_t i = 0; i < n; i++)
+		for (int p = 0; p < numPass; p++)
+			count[p * numBucket + (key[i] >> p * lenDigit & (numBucket - 1))]++;
+	for (int p = 0; p < numPass; p++) {
+		size_t* const c = count.data() + p * numBucket;
+		if (n == 0 || c[key[0] >> p * lenDigit & (numBucket - 1)] == n) continue;
+		for (size_t b = 0, sum = 0; b < numBucket; b++) {
+			const size_t a = c[b];
+			c[b] = sum;
+			sum += a;
+		}
+		for (size_t i = 0; i < n; i++)
+			scratch[c[key[i] >> p * lenDigit & (numBucket - 1)]++] = key[i];
+		std::swap(key, scratch);
+	}
+	if (key != out)
+		std::memcpy(out, key, n * sizeof(K));
+}
+}
+
+/// Same area as the trapezoidal ROC curve, i.e., P(positive score > negative score) with ties counting half
+/// Keys of positives and of negatives are radix sorted separately, then merged, no comparison sort and no temporary double arrays
+/// @tparam T Type of array elements, float or double
 /// @param yTrue Array of ground truth labels, 0.0 is negative, 1.0 is positive
 /// @param yPred Array of predicted scores, can be of any range
 /// @param n Number of elements in the array
-/// @return AUROC/ROC-AUC score, range [0.0, 1.0]
+/// @return AUROC/ROC-AUC score, range [0.0, 1.0], -1 if any input is invalid, NaN if only one class is present
 template<class T>
 double AUROC(const T* yTrue, const T* yPred, size_t n) {
+	typedef typename AUROCDetail::KeyOf<T>::Type K;
+	size_t numPositive = 0;
 	for (size_t i = 0; i < n; i++) {
 		if (std::isnan(yPred[i]) || std::isinf(yPred[i]) || yTrue[i] != 0 && yTrue[i] != 1)
 			return -1;
+		numPositive += yTrue[i] == 1;
 	}
+	const size_t numNegative = n - numPositive;
+	if (numPositive == 0 || numNegative == 0)
+		return std::numeric_limits<double>::quiet_NaN();
 
-	const auto index = new size_t[n];
-	for (size_t i = 0; i < n; i++) index[i] = i;
-	// std::iota(index, index + n, 0); // Equivalent to above
-	std::sort(index, index + n, [&](size_t a, size_t b) { return yPred[a] > yPred[b]; });
-	const auto y = new double[n]; // Desc
-	const auto z = new double[n]; // Desc
-	for (size_t i = 0; i < n; i++) {
-		y[i] = yTrue[index[i]];
-		z[i] = yPred[index[i]];
-	}
+	std::vector<K> key(2 * n); // Positives at [0, numPositive), negatives at [numPositive, n), then scratch
+	for (size_t i = 0, p = 0, q = numPositive; i < n; i++)
+		key[yTrue[i] == 1 ? p++ : q++] = AUROCDetail::Key(yPred[i]);
+	K* const positive = key.data();
+	K* const negative = positive + numPositive;
+	AUROCDetail::RadixSort(positive, key.data() + n, numPositive);
+	AUROCDetail::RadixSort(negative, key.data() + n + numPositive, numNegative);
 
-	const auto tp = y; // Reuse
-	tp[0] = y[0];
-	for (size_t i = 1; i < n; i++) {
-		tp[i] = tp[i - 1] + y[i];
-	} // Equivalent to below
-	// std::partial_sum(y, y + n, tp);
-
-	size_t top = 0; // # diff
-	for (size_t i = 0; i < n - 1; i++) {
-		if (z[i] != z[i + 1])
-			index[top++] = i;
+	// 2 * U, integer, exact
+	uint64_t u2 = 0;
+	for (size_t i = 0, below = 0, equal; i < numPositive; i += equal) {
+		const K k = positive[i];
+		while (below < numNegative && negative[below] < k) below++;
+		size_t tie = below;
+		while (tie < numNegative && negative[tie] == k) tie++;
+		for (equal = 1; i + equal < numPositive && positive[i + equal] == k; equal++);
+		u2 += equal * (2 * below + (tie - below));
 	}
-	index[top++] = n - 1;
-	n = top; // Size of y/z -> sizeof tps/fps
-	delete[] z;
+	return u2 / (2.0 * numPositive * numNegative);
+}
 
-	const auto fp = new double[n];
-	for (size_t i = 0; i < n; i++) {
-		tp[i] = tp[index[i]];
-		fp[i] = 1 + index[i] - tp[i];
+/// AUROC of the last lenWindow pairs of a stream, O(numBit) per Push() instead of sorting the window again
+/// Scores are bucketed by the top numBit bits of their keys, e.g., sign, exponent and numBit - 9 mantissa bits of a float, so scores in one bucket are ties
+/// Same as AUROC() on the window if no two different scores share a bucket
+/// @tparam T Type of labels and scores, float or double
+template<class T>
+struct SlidingAUROC {
+	typedef typename AUROCDetail::KeyOf<T>::Type K;
+	const size_t lenWindow;
+	const int numBit; // Resolution, the trees take 2^(numBit + 3) bytes
+	std::vector<uint32_t> bucketWindow; // Ring of buckets of the window, the label is the lowest bit
+	std::vector<uint32_t> treePositive, treeNegative; // Fenwick trees of # positives/negatives in each bucket
+	size_t head = 0; // Oldest pair of a full window
+	size_t numPositive = 0, numNegative = 0;
+	int64_t u2 = 0; // 2 * U of the window, see AUROC()
+
+	explicit SlidingAUROC(size_t lenWindow, int numBit = 20):
+		lenWindow(lenWindow),
+		numBit(numBit),
+		treePositive((size_t(1) << numBit) + 1, 0),
+		treeNegative((size_t(1) << numBit) + 1, 0) {
+		bucketWindow.reserve(lenWindow);
 	}
-	delete[] index;
-
-	const auto tp_diff = new double[n];
-	const auto fp_diff = new double[n];
-	for (size_t i = 1; i < n; i++) {
-		tp_diff[i] = tp[i] - tp[i - 1];
-		fp_diff[i] = fp[i] - fp[i - 1];
-	} // Equivalent to below
-	// std::adjacent_difference(tp, tp + n, tp_diff);
-	// std::adjacent_difference(fp, fp + n, fp_diff);
-	top = 1;
-	for (size_t i = 1; i < n - 1; i++) {
-		if (tp_diff[i] != tp_diff[i + 1] || fp_diff[i] != fp_diff[i + 1]) {
-			tp[top] = tp[i];
-			fp[top] = fp[i];
-			top++;
-		}
+
+	/// # in buckets [0, b)
+	static uint64_t Below(const std::vector<uint32_t>& tree, uint32_t b) {
+		uint64_t sum = 0;
+		for (; b; b &= b - 1)
+			sum += tree[b];
+		return sum;
 	}
-	tp[top] = tp[n - 1];
-	fp[top] = fp[n - 1];
-	n = ++top; // Size of tp/fp -> size of optimized tp/fp 
-	delete[] tp_diff;
-	delete[] fp_diff;
 
-	for (size_t i = 0; i < n; i++) {
-		tp[i] /= tp[n - 1];
-		fp[i] /= fp[n - 1];
+	static void Update(std::vector<uint32_t>& tree, uint32_t b, int by) {
+		for (b++; b < tree.size(); b += b & (0u - b))
+			tree[b] += by;
 	}
 
-	double area = tp[0] * fp[0] / 2; // The first triangle from origin
-	for (size_t i = 0; i < n - 1; i++) {
-		area += (tp[i] + tp[i + 1]) * (fp[i + 1] - fp[i]) / 2;
+	/// Change of 2 * U by a pair of bucket b, the same with or without the pair itself in the trees
+	int64_t Contribution(uint32_t b, bool positive) const {
+		if (positive)
+			return 2 * Below(treeNegative, b) + (Below(treeNegative, b + 1) - Below(treeNegative, b));
+		const uint64_t belowPositive = Below(treePositive, b), atPositive = Below(treePositive, b + 1) - belowPositive;
+		return 2 * (numPositive - belowPositive - atPositive) + atPositive;
 	}
 
-	delete[] tp;
-	delete[] fp;
+	/// @param label 0.0 is negative, 1.0 is positive
+	/// @param score Should be finite
+	void Push(T label, T score) {
+		const bool positive = label == 1;
+		const uint32_t b = static_cast<uint32_t>(AUROCDetail::Key(score) >> (sizeof(K) * 8 - numBit));
+		if (bucketWindow.size() == lenWindow) { // Evict the oldest
+			const uint32_t bOld = bucketWindow[head] >> 1;
+			const bool positiveOld = bucketWindow[head] & 1;
+			if (positiveOld) {
+				Update(treePositive, bOld, -1);
+				numPositive--;
+			} else {
+				Update(treeNegative, bOld, -1);
+				numNegative--;
+			}
+			u2 -= Contribution(bOld, positiveOld);
+			bucketWindow[head] = b << 1 | positive;
+			head = (head + 1) % lenWindow;
+		} else {
+			bucketWindow.push_back(b << 1 | positive);
+		}
+		u2 += Contribution(b, positive);
+		if (positive) {
+			Update(treePositive, b, 1);
+			numPositive++;
+		} else {
+			Update(treeNegative, b, 1);
+			numNegative++;
+		}
+	}
 
-	return area;
-}
+	/// @return AUROC of the window, NaN if only one class is present
+	double operator()() const {
+		return numPositive && numNegative ? u2 / (2.0 * numPositive * numNegative) : std::numeric_limits<double>::quiet_NaN();
+	}
+};
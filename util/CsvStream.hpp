@@ -0,0 +1,197 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace MIDAS {
+// Parse an optionally signed decimal integer in [p, end), surrounding blanks are skipped, p is moved past them, false if there is no digit
+inline bool ParseInt(const char*& p, const char* end, int& out) {
+	while (p < end && (*p == ' ' || *p == '\t')) p++;
+	const bool negative = p < end && *p == '-';
+	if (p < end && (*p == '-' || *p == '+')) p++;
+	if (p == end || *p < '0' || *p > '9') return false;
+	unsigned value = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+		value = value * 10 + (*p - '0');
+	while (p < end && (*p == ' ' || *p == '\t')) p++;
+	out = static_cast<int>(negative ? 0u - value : value);
+	return true;
+}
+
+// "source,destination,timestamp" lines, parsed in chunks on a background thread
+// While the caller scores chunk k, chunk k + 1 is being parsed, memory is two chunks and one read buffer regardless of input length
+// Lines that are not 3 integers, e.g., a header, are skipped and counted
+struct CsvStream {
+	const size_t lenChunk; // # records of a chunk
+	constexpr static size_t lenText = 1 << 20; // Bytes of a read
+	FILE* const file;
+	const bool owned; // Whether to fclose() the file, stdin is not owned
+	char* const text;
+	const char* cursor; // Unparsed bytes are [cursor, textEnd)
+	const char* textEnd;
+	bool eof = false;
+	size_t numSkipped = 0; // # malformed lines, written by the parser thread, read it after the end
+
+	struct Chunk {
+		int* source;
+		int* destination;
+		int* timestamp;
+		size_t n;
+		bool ready; // Parsed and not yet released by the caller
+	} chunk[2];
+	int current = -1; // Chunk held by the caller
+	bool stop = false;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::thread parser; // Last, so it starts after everything above
+
+	// path "-" is stdin, a missing file gives an empty stream
+	explicit CsvStream(const char* path, size_t lenChunk = 1 << 16):
+		lenChunk(lenChunk),
+		file(std::strcmp(path, "-") ? fopen(path, "rb") : stdin),
+		owned(file != stdin),
+		text(new char[lenText]),
+		cursor(text),
+		textEnd(text) {
+		for (auto& c: chunk) {
+			c.source = new int[lenChunk];
+			c.destination = new int[lenChunk];
+			c.timestamp = new int[lenChunk];
+			c.n = 0;
+			c.ready = false;
+		}
+		parser = std::thread(&CsvStream::Parse, this);
+	}
+
+	CsvStream(const CsvStream& b) = delete;
+	CsvStream& operator=(const CsvStream& b) = delete;
+
+	~CsvStream() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		condition.notify_all();
+		parser.join();
+		if (file && owned) fclose(file);
+		delete[] text;
+		for (auto& c: chunk) {
+			delete[] c.source;
+			delete[] c.destination;
+			delete[] c.timestamp;
+		}
+	}
+
+	// Next chunk of records, 0 at the end and do not call again, arrays are valid until the next call
+	size_t Next(const int*& source, const int*& destination, const int*& timestamp) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (current >= 0) { // Hand the previous one back to the parser
+			chunk[current].ready = false;
+			condition.notify_all();
+		}
+		current = (current + 1) % 2;
+		condition.wait(lock, [&] { return chunk[current].ready; });
+		source = chunk[current].source;
+		destination = chunk[current].destination;
+		timestamp = chunk[current].timestamp;
+		return chunk[current].n;
+	}
+
+	// Read more bytes, keeping the unparsed tail, false if nothing more
+	bool Refill() {
+		if (eof) return false;
+		const size_t lenTail = textEnd - cursor;
+		std::memmove(text, cursor, lenTail);
+		const size_t lenRead = file ? fread(text + lenTail, 1, lenText - lenTail, file) : 0;
+		eof = lenRead == 0;
+		cursor = text;
+		textEnd = text + lenTail + lenRead;
+		return !eof;
+	}
+
+	// Parse one line into record i of c, false if the input is exhausted
+	bool ParseLine(Chunk& c, size_t i, bool& valid) {
+		const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', textEnd - cursor));
+		while (!newline) {
+			if (textEnd - cursor == static_cast<ptrdiff_t>(lenText)) { // A line longer than the buffer, not an edge anyway, discarded up to its '\n'
+				do {
+					cursor = textEnd;
+					if (!Refill()) break;
+					newline = static_cast<const char*>(std::memchr(cursor, '\n', textEnd - cursor));
+				} while (!newline);
+				cursor = newline ? newline + 1 : textEnd;
+				numSkipped++;
+				valid = false;
+				return true;
+			}
+			if (!Refill()) {
+				if (cursor == textEnd) return false;
+				newline = textEnd; // The last line without '\n'
+				break;
+			}
+			newline = static_cast<const char*>(std::memchr(cursor, '\n', textEnd - cursor));
+		}
+		const char* p = cursor;
+		const char* const end = newline > cursor && newline[-1] == '\r' ? newline - 1 : newline;
+		valid = ParseInt(p, end, c.source[i]) && p < end && *p++ == ','
+			&& ParseInt(p, end, c.destination[i]) && p < end && *p++ == ','
+			&& ParseInt(p, end, c.timestamp[i]);
+		valid = valid && p == end;
+		if (!valid && end > cursor) numSkipped++; // Blank lines are not counted
+		cursor = newline == textEnd ? textEnd : newline + 1;
+		return true;
+	}
+
+	// Parser thread
+	void Parse() {
+		for (int k = 0;; k = (k + 1) % 2) {
+			Chunk& c = chunk[k];
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [&] { return !c.ready || stop; });
+				if (stop) return;
+			}
+			size_t n = 0;
+			bool more = true, valid;
+			while (n < lenChunk && (more = ParseLine(c, n, valid)))
+				n += valid;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				c.n = n;
+				c.ready = true;
+			}
+			condition.notify_all();
+			if (!more && n) { // Still owe an empty chunk as the end mark
+				k = (k + 1) % 2;
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [&] { return !chunk[k].ready || stop; });
+				if (stop) return;
+				chunk[k].n = 0;
+				chunk[k].ready = true;
+				lock.unlock();
+				condition.notify_all();
+			}
+			if (!more) return;
+		}
+	}
+};
+}
@@ -0,0 +1,172 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "CsvStream.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Binary columnar edge file, all little-endian
+// [0, 128): EdgeFileHeader, zero-padded
+// [offsetSource, +4n): int32 sources, same for destinations and timestamps, each column starts at a multiple of 64 bytes
+// The file is mapped as is, so columns are handed out as const int* without any copy
+
+namespace MIDAS {
+struct EdgeFileHeader {
+	char magic[8]; // "MIDASEDG"
+	uint32_t version;
+	uint32_t lenHeader; // Bytes before the first column
+	uint64_t numRecord;
+	int32_t timestampMin, timestampMax;
+	int32_t sourceMin, sourceMax;
+	int32_t destinationMin, destinationMax;
+	uint64_t offsetSource, offsetDestination, offsetTimestamp; // Bytes from the beginning of the file
+};
+
+constexpr char edgeFileMagic[8] = {'M', 'I', 'D', 'A', 'S', 'E', 'D', 'G'};
+constexpr uint32_t edgeFileVersion = 1;
+constexpr uint64_t edgeFileLenHeader = 128;
+constexpr uint64_t edgeFileAlignment = 64;
+static_assert(sizeof(EdgeFileHeader) <= edgeFileLenHeader, "Header should fit in its reserved bytes");
+
+// Write the header and columns of n records, return false on I/O errors
+inline bool WriteEdgeFile(const char* pathBinary, const int* source, const int* destination, const int* timestamp, size_t n) {
+	EdgeFileHeader header = {};
+	std::memcpy(header.magic, edgeFileMagic, sizeof(header.magic));
+	header.version = edgeFileVersion;
+	header.lenHeader = edgeFileLenHeader;
+	header.numRecord = n;
+	header.timestampMin = header.sourceMin = header.destinationMin = INT_MAX;
+	header.timestampMax = header.sourceMax = header.destinationMax = INT_MIN;
+	for (size_t i = 0; i < n; i++) {
+		header.sourceMin = std::min(header.sourceMin, source[i]);
+		header.sourceMax = std::max(header.sourceMax, source[i]);
+		header.destinationMin = std::min(header.destinationMin, destination[i]);
+		header.destinationMax = std::max(header.destinationMax, destination[i]);
+		header.timestampMin = std::min(header.timestampMin, timestamp[i]);
+		header.timestampMax = std::max(header.timestampMax, timestamp[i]);
+	}
+	const uint64_t lenColumn = (n * sizeof(int) + edgeFileAlignment - 1) / edgeFileAlignment * edgeFileAlignment;
+	header.offsetSource = edgeFileLenHeader;
+	header.offsetDestination = header.offsetSource + lenColumn;
+	header.offsetTimestamp = header.offsetDestination + lenColumn;
+
+	const auto file = fopen(pathBinary, "wb");
+	if (!file) return false;
+	char padding[edgeFileLenHeader] = {};
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(padding, edgeFileLenHeader - sizeof(header), 1, file) == 1;
+	for (const int* column: {source, destination, timestamp})
+		ok = ok && fwrite(column, sizeof(int), n, file) == n && (lenColumn == n * sizeof(int) || fwrite(padding, lenColumn - n * sizeof(int), 1, file) == 1);
+	return fclose(file) == 0 && ok;
+}
+
+// Convert "source,destination,timestamp" lines, e.g., darpa_processed.csv from PreprocessData.py, return false on I/O errors
+inline bool ConvertEdgeFile(const char* pathCsv, const char* pathBinary) {
+	CsvStream csv(pathCsv);
+	if (!csv.file) return false;
+	std::vector<int> source, destination, timestamp;
+	const int* s, * d, * t;
+	for (size_t n; (n = csv.Next(s, d, t));) {
+		source.insert(source.end(), s, s + n);
+		destination.insert(destination.end(), d, d + n);
+		timestamp.insert(timestamp.end(), t, t + n);
+	}
+	return WriteEdgeFile(pathBinary, source.data(), destination.data(), timestamp.data(), source.size());
+}
+
+// Read-only mapping of an edge file, header is nullptr if the file is missing or not an edge file
+struct EdgeFile {
+	const EdgeFileHeader* header = nullptr;
+	size_t n = 0;
+	const int* source = nullptr;
+	const int* destination = nullptr;
+	const int* timestamp = nullptr;
+	void* address = nullptr;
+	size_t size = 0;
+
+	explicit EdgeFile(const char* path) {
+#ifdef _WIN32
+		const HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return;
+		LARGE_INTEGER lenFile;
+		if (GetFileSizeEx(file, &lenFile) && lenFile.QuadPart > 0) {
+			const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping) {
+				address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				CloseHandle(mapping); // The view keeps the mapping alive
+			}
+			size = address ? static_cast<size_t>(lenFile.QuadPart) : 0;
+		}
+		CloseHandle(file);
+#else
+		const int file = open(path, O_RDONLY);
+		if (file < 0) return;
+		struct stat status;
+		if (fstat(file, &status) == 0 && status.st_size > 0) {
+			address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+			if (address == MAP_FAILED)
+				address = nullptr;
+			else {
+				size = status.st_size;
+				madvise(address, size, MADV_SEQUENTIAL); // Cores read records in order
+			}
+		}
+		close(file); // The mapping keeps the file alive
+#endif
+		if (!address || size < edgeFileLenHeader) return;
+		const auto h = static_cast<const EdgeFileHeader*>(address);
+		const uint64_t lenColumn = h->numRecord * sizeof(int);
+		if (std::memcmp(h->magic, edgeFileMagic, sizeof(h->magic)) || h->version != edgeFileVersion
+			|| h->offsetSource + lenColumn > size || h->offsetDestination + lenColumn > size || h->offsetTimestamp + lenColumn > size)
+			return;
+		header = h;
+		n = h->numRecord;
+		source = reinterpret_cast<const int*>(static_cast<const char*>(address) + h->offsetSource);
+		destination = reinterpret_cast<const int*>(static_cast<const char*>(address) + h->offsetDestination);
+		timestamp = reinterpret_cast<const int*>(static_cast<const char*>(address) + h->offsetTimestamp);
+	}
+
+	EdgeFile(const EdgeFile& b) = delete;
+	EdgeFile& operator=(const EdgeFile& b) = delete;
+
+	~EdgeFile() {
+		if (!address) return;
+#ifdef _WIN32
+		UnmapViewOfFile(address);
+#else
+		munmap(address, size);
+#endif
+	}
+};
+}
@@ -17,6 +17,7 @@
 from pathlib import Path
 from sys import argv
 
+from numpy import fromfile
 from pandas import read_csv
 from sklearn.metrics import roc_auc_score
 
@@ -25,9 +26,10 @@ root = (Path(__file__) / '../..').resolve()
 if len(argv) < 3:
 	print('Print ROC-AUC to stdout and MIDAS/temp/AUC[<indexRun>].txt')
 	print('Usage: python EvaluateScore.py <pathGroundTruth> <pathScore> [<indexRun>]')
+	print('pathScore is text, or raw float32 if it ends with .bin')
 else:
 	y = read_csv(argv[1], header=None)
-	z = read_csv(argv[2], header=None)
+	z = fromfile(argv[2], '<f4') if argv[2].endswith('.bin') else read_csv(argv[2], header=None)
 	indexRun = argv[3] if len(argv) >= 4 else ''
 	auc = roc_auc_score(y, z)
 	print(f"ROC-AUC{indexRun} = {auc:.4f}")
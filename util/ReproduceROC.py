@@ -17,7 +17,7 @@
 from pathlib import Path
 from sys import argv
 
-from numpy import array, savetxt
+from numpy import array, fromfile, savetxt
 from pandas import read_csv
 from sklearn.metrics import auc, roc_curve
 
@@ -26,9 +26,10 @@ root = (Path(__file__) / '../..').resolve()
 if len(argv) < 3:
 	print('Print ROC-AUC to stdout and save points on ROC curve to MIDAS/<pathROC> (default temp/ROC.csv)')
 	print('Usage: python ReproduceROC.py <pathGroundTruth> <pathScore> [<pathROC>]')
+	print('pathScore is text, or raw float32 if it ends with .bin')
 else:
 	y = read_csv(argv[1], header=None)
-	z = read_csv(argv[2], header=None)
+	z = fromfile(argv[2], '<f4') if argv[2].endswith('.bin') else read_csv(argv[2], header=None)
 	fpr, tpr, _ = roc_curve(y, z, pos_label=1)
 	print(f"ROC-AUC = {auc(fpr, tpr):.4f}")
 	pathROC = argv[3] if len(argv) >= 4 else 'temp/ROC.csv'
@@ -0,0 +1,250 @@
+// -----------------------------------------------------------------------------
+// Copyright 2020 Rui Liu (liurui39660) and Siddharth Bhatia (bhatiasiddharth)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// -----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MIDAS {
+// Destination of scores, in stream order
+struct ScoreSink {
+	virtual ~ScoreSink() = default;
+
+	virtual void Write(const float* score, size_t n) = 0;
+
+	void Write(float score) {
+		Write(&score, 1);
+	}
+
+	// Push everything written so far to the file, false if any I/O error so far
+	virtual bool Flush() = 0;
+};
+
+// Raw little-endian float32, e.g., numpy.fromfile(path, '<f4')
+struct BinaryScoreSink: ScoreSink {
+	FILE* const file;
+	bool ok;
+
+	explicit BinaryScoreSink(const char* path): file(fopen(path, "wb")), ok(file != nullptr) { }
+
+	BinaryScoreSink(const BinaryScoreSink& b) = delete;
+	BinaryScoreSink& operator=(const BinaryScoreSink& b) = delete;
+
+	~BinaryScoreSink() override {
+		if (file) fclose(file);
+	}
+
+	using ScoreSink::Write;
+
+	static bool IsLittleEndian() {
+		const uint32_t one = 1;
+		return *reinterpret_cast<const unsigned char*>(&one) == 1;
+	}
+
+	void Write(const float* score, size_t n) override {
+		if (!ok) return;
+		if (IsLittleEndian()) {
+			ok = fwrite(score, sizeof(float), n, file) == n;
+			return;
+		}
+		for (size_t i = 0; i < n && ok; i++) {
+			uint32_t a;
+			std::memcpy(&a, score + i, sizeof(a));
+			const unsigned char byte[4] = {static_cast<unsigned char>(a), static_cast<unsigned char>(a >> 8), static_cast<unsigned char>(a >> 16), static_cast<unsigned char>(a >> 24)};
+			ok = fwrite(byte, 1, 4, file) == 4;
+		}
+	}
+
+	bool Flush() override {
+		return ok && fflush(file) == 0;
+	}
+};
+
+// One "%f\n" line per score, byte for byte as fprintf() in the C locale, formatted without stdio
+struct TextScoreSink: ScoreSink {
+	FILE* const file;
+	bool ok;
+	constexpr static size_t lenText = 1 << 16;
+	constexpr static size_t lenLine = 64; // Room of a line, -FLT_MAX takes 48 bytes and a NUL
+	char text[lenText];
+	size_t lenUsed = 0;
+
+	explicit TextScoreSink(const char* path): file(fopen(path, "w")), ok(file != nullptr) { }
+
+	TextScoreSink(const TextScoreSink& b) = delete;
+	TextScoreSink& operator=(const TextScoreSink& b) = delete;
+
+	~TextScoreSink() override {
+		Flush();
+		if (file) fclose(file);
+	}
+
+	using ScoreSink::Write;
+
+	// Format a with 6 decimals and a trailing '\n', return the length
+	// A float times 10^6 is exact in double, so rounding it to an integer is the same as printf() rounding the exact value, ties to even
+	static size_t Format(float a, char* out) {
+		const double scaled = std::fabs(static_cast<double>(a)) * 1e6;
+		if (!(scaled < 1e19)) // Also NaN and infinity
+			return snprintf(out, lenLine, "%f\n", a);
+		uint64_t value = static_cast<uint64_t>(std::nearbyint(scaled));
+		char digit[24];
+		int m = 0;
+		do {
+			digit[m++] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		} while (value || m < 7); // At least "0.000000"
+		size_t l = 0;
+		if (std::signbit(a)) out[l++] = '-';
+		while (m > 6) out[l++] = digit[--m];
+		out[l++] = '.';
+		while (m > 0) out[l++] = digit[--m];
+		out[l++] = '\n';
+		return l;
+	}
+
+	void Write(const float* score, size_t n) override {
+		for (size_t i = 0; i < n; i++) {
+			if (lenUsed + lenLine > lenText) Drain();
+			lenUsed += Format(score[i], text + lenUsed);
+		}
+	}
+
+	void Drain() {
+		ok = ok && fwrite(text, 1, lenUsed, file) == lenUsed;
+		lenUsed = 0;
+	}
+
+	bool Flush() override {
+		Drain();
+		return ok && fflush(file) == 0;
+	}
+};
+
+// Copies scores into large buffers, a background thread passes full ones to another sink, e.g., formats and writes them
+// The caller only waits if all buffers are still queued, i.e., the disk is slower than scoring for a long time
+struct AsyncScoreSink final: ScoreSink {
+	const std::unique_ptr<ScoreSink> sink;
+	const size_t lenBuffer; // # scores of a buffer
+	std::vector<float*> buffer;
+	std::vector<size_t> length; // # scores in each buffer
+	int current; // Buffer filled by the caller
+	std::deque<int> full, empty;
+	bool busy = false; // Writer is writing a buffer
+	bool stop = false;
+	uint64_t numWait = 0; // # times the caller found no empty buffer
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::thread writer; // Last, so it starts after everything above
+
+	// Takes ownership of sink
+	explicit AsyncScoreSink(ScoreSink* sink, size_t lenBuffer = 1 << 20, int numBuffer = 4):
+		sink(sink),
+		lenBuffer(lenBuffer),
+		length(numBuffer, 0),
+		current(0) {
+		for (int i = 0; i < numBuffer; i++) {
+			buffer.push_back(new float[lenBuffer]);
+			if (i) empty.push_back(i);
+		}
+		writer = std::thread(&AsyncScoreSink::Work, this);
+	}
+
+	AsyncScoreSink(const AsyncScoreSink& b) = delete;
+	AsyncScoreSink& operator=(const AsyncScoreSink& b) = delete;
+
+	~AsyncScoreSink() override {
+		Flush();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		condition.notify_all();
+		writer.join();
+		for (const auto b: buffer)
+			delete[] b;
+	}
+
+	using ScoreSink::Write;
+
+	void Write(const float* score, size_t n) override {
+		while (n) {
+			const size_t m = std::min(n, lenBuffer - length[current]);
+			std::memcpy(buffer[current] + length[current], score, m * sizeof(float));
+			length[current] += m;
+			score += m;
+			n -= m;
+			if (length[current] == lenBuffer) Submit();
+		}
+	}
+
+	// Single score, no virtual call
+	void Write(float score) {
+		buffer[current][length[current]++] = score;
+		if (length[current] == lenBuffer) Submit();
+	}
+
+	// Queue the current buffer and take an empty one
+	void Submit() {
+		std::unique_lock<std::mutex> lock(mutex);
+		full.push_back(current);
+		condition.notify_all();
+		if (empty.empty()) {
+			numWait++;
+			condition.wait(lock, [&] { return !empty.empty(); });
+		}
+		current = empty.front();
+		empty.pop_front();
+	}
+
+	// Wait for the writer, then flush the sink
+	bool Flush() override {
+		if (length[current]) Submit();
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [&] { return full.empty() && !busy; });
+		return sink->Flush();
+	}
+
+	// Writer thread
+	void Work() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			condition.wait(lock, [&] { return !full.empty() || stop; });
+			if (full.empty()) return;
+			const int b = full.front();
+			full.pop_front();
+			busy = true;
+			lock.unlock();
+			sink->Write(buffer[b], length[b]);
+			length[b] = 0;
+			lock.lock();
+			busy = false;
+			empty.push_back(b);
+			condition.notify_all();
+		}
+	}
+};
+}